@@ -0,0 +1,123 @@
+// Сравнение точности суммирования сил: производительность ядра и дрейф энергии.
+// Сборка: cmake -DNBODY_BUILD_BENCHMARKS=ON .. && make force_precision_benchmark
+// (без GTK: cmake -DNBODY_BUILD_APP=OFF -DNBODY_BUILD_BENCHMARKS=ON ..)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/Vector.hpp"
+#include "simulators/DirectSumForce.hpp"
+#include "simulators/NewtonianSimulator.hpp"
+#include "systems/System.hpp"
+
+using namespace nbody;
+
+
+
+// Центральное тело единичной массы и n почти пробных тел на круговых орбитах с радиусами
+// от 1 до 2: тела не сближаются, поэтому дрейф энергии определяется точностью сил
+class RingSystem : public System<double> {
+public:
+    explicit RingSystem(std::size_t n) : n_(n) {}
+
+    void generate() override {
+        this->clear();
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> phase(0.0, 2.0 * M_PI);
+        std::uniform_real_distribution<double> height(-0.01, 0.01);
+
+        this->add_body(Body<double>(1.0, Vector<double>{}, Vector<double>{}), "center");
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double angle = phase(generator);
+            const double r = 1.0 + double(i) / double(n_);
+            const double speed = std::sqrt(1.0 / r);
+            this->add_body(Body<double>(1e-9, Vector<double>(r * std::cos(angle), r * std::sin(angle), height(generator)),
+                                        Vector<double>(-speed * std::sin(angle), speed * std::cos(angle), 0.0)));
+        }
+    }
+
+    double graph_value() const override {
+        double energy = 0.0;
+        const auto& bodies = this->bodies();
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            energy += 0.5 * bodies[i].mass() * bodies[i].velocity().magnitude_squared();
+            for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                energy -= bodies[i].mass() * bodies[j].mass() / (bodies[j].position() - bodies[i].position()).magnitude();
+            }
+        }
+        return energy;
+    }
+
+private:
+    std::size_t n_;
+};
+
+template <typename Precision>
+double pairs_per_second(const std::vector<Body<double>>& bodies, std::vector<Vector<double>>& accelerations) {
+    DirectSumForce<double, Precision> force;
+    const std::size_t n = bodies.size();
+    const int repeats = std::max<int>(1, int(2e8 / double(n * n)));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        force.compute(bodies, accelerations);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return double(repeats) * double(n) * double(n - 1) / 2.0 / seconds;
+}
+
+double max_relative_error(const std::vector<Vector<double>>& reference, const std::vector<Vector<double>>& result) {
+    double error = 0.0;
+    for (std::size_t i = 0; i < reference.size(); ++i) {
+        error = std::max(error, (result[i] - reference[i]).magnitude() / reference[i].magnitude());
+    }
+    return error;
+}
+
+// Наибольшее относительное отклонение энергии RingSystem за steps шагов PEFRL
+template <typename Precision>
+double energy_drift(std::size_t n, int steps, double dt) {
+    RingSystem system(n);
+    system.generate();
+    NewtonianSimulator<double, PEFRL, 3, Precision> simulator;
+    simulator.set_system(&system);
+    simulator.set_dt(dt);
+
+    const double initial = system.graph_value();
+    double drift = 0.0;
+    for (int s = 1; s <= steps; ++s) {
+        simulator.step();
+        if (s % 100 == 0) {
+            drift = std::max(drift, std::abs((system.graph_value() - initial) / initial));
+        }
+    }
+    return drift;
+}
+
+int main() {
+    std::printf("%8s %14s %14s %14s %12s %12s\n", "N", "double, 1/s", "mixed, 1/s", "float, 1/s",
+                "err mixed", "err float");
+    for (std::size_t n : {256, 1024, 4096}) {
+        RingSystem system(n);
+        system.generate();
+        const std::vector<Body<double>>& bodies = system.bodies();
+        std::vector<Vector<double>> full, mixed, single;
+        const double full_rate = pairs_per_second<FullPrecision>(bodies, full);
+        const double mixed_rate = pairs_per_second<MixedPrecision>(bodies, mixed);
+        const double single_rate = pairs_per_second<SinglePrecision>(bodies, single);
+        std::printf("%8zu %14.3e %14.3e %14.3e %12.2e %12.2e\n", n, full_rate, mixed_rate, single_rate,
+                    max_relative_error(full, mixed), max_relative_error(full, single));
+    }
+
+    const std::size_t n = 256;
+    const int steps = 10000;
+    const double dt = 1e-2;
+    std::printf("\nДрейф энергии, %zu тел, PEFRL, %d шагов dt = %g:\n", n, steps, dt);
+    std::printf("  double %.3e\n  mixed  %.3e\n  float  %.3e\n", energy_drift<FullPrecision>(n, steps, dt),
+                energy_drift<MixedPrecision>(n, steps, dt), energy_drift<SinglePrecision>(n, steps, dt));
+    return 0;
+}
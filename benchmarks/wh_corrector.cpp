@@ -0,0 +1,115 @@
+// Проверка симплектических корректоров WisdomHolmanSimulator: ошибка энергии должна
+// убывать с шагом тем быстрее, чем выше порядок корректора.
+// Сборка: cmake -DNBODY_BUILD_BENCHMARKS=ON .. && make wh_corrector_benchmark
+// (без GTK: cmake -DNBODY_BUILD_APP=OFF -DNBODY_BUILD_BENCHMARKS=ON ..)
+// Возвращает 1, если наклон ошибки по dt для какого-либо порядка меньше ожидаемого
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "core/Body.hpp"
+#include "core/Vector.hpp"
+#include "simulators/WisdomHolmanSimulator.hpp"
+#include "systems/System.hpp"
+
+using namespace nbody;
+
+
+
+// Звезда единичной массы и две планеты массы порядка 1e-5 на почти круговых орбитах
+// (G = 1, период внутренней планеты 2*pi). Малые массы отодвигают вклад порядка eps^2*dt^2,
+// который корректор не устраняет, ниже ошибки eps*dt^n
+class PlanetarySystem : public System<double> {
+public:
+    void generate() override {
+        this->clear();
+        this->add_body(Body<double>(1.0, Vector<double>{}, Vector<double>{}), "star");
+        add_planet(1e-5, 1.0, 0.0);
+        add_planet(3e-6, 1.83, 2.0);
+
+        double mass = 0.0;
+        Vector<double> moment, momentum;
+        for (const auto& body : this->bodies()) {
+            mass += body.mass();
+            moment.add_scaled(body.position(), body.mass());
+            momentum.add_scaled(body.velocity(), body.mass());
+        }
+        for (auto& body : this->bodies()) {
+            body.set_position(body.position() - moment / mass);
+            body.set_velocity(body.velocity() - momentum / mass);
+        }
+    }
+
+    double graph_value() const override {
+        double energy = 0.0;
+        const auto& bodies = this->bodies();
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            energy += 0.5 * bodies[i].mass() * bodies[i].velocity().magnitude_squared();
+            for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                energy -= bodies[i].mass() * bodies[j].mass() / (bodies[j].position() - bodies[i].position()).magnitude();
+            }
+        }
+        return energy;
+    }
+
+private:
+    // Перицентр на расстоянии a*(1-e) при e = 0.05, небольшой наклон по z
+    void add_planet(double mass, double a, double phase) {
+        const double e = 0.05;
+        const double r = a * (1.0 - e);
+        const double speed = std::sqrt((1.0 + mass) * (1.0 + e) / r);
+        this->add_body(Body<double>(mass, Vector<double>(r * std::cos(phase), r * std::sin(phase), 0.01),
+                                    Vector<double>(-speed * std::sin(phase), speed * std::cos(phase), 0.0)));
+    }
+};
+
+// Наибольшее относительное отклонение энергии за 200 периодов внутренней планеты;
+// состояние с корректором записывается в систему через synchronize()
+double energy_error(int corrector_order, double dt) {
+    PlanetarySystem system;
+    system.generate();
+    WisdomHolmanSimulator<double> simulator;
+    simulator.set_system(&system);
+    simulator.set_dt(dt);
+    simulator.set_corrector_order(corrector_order);
+    simulator.set_safe_mode(false);
+
+    const double initial = system.graph_value();
+    const int steps = int(200.0 * 2.0 * M_PI / dt);
+    double error = 0.0;
+    for (int s = 1; s <= steps; ++s) {
+        simulator.step();
+        if (s % 16 == 0) {
+            simulator.synchronize();
+            error = std::max(error, std::abs((system.graph_value() - initial) / initial));
+        }
+    }
+    return error;
+}
+
+int main() {
+    // Ошибка ведёт себя как eps*dt^2 без корректора, eps*dt^4 и eps*dt^6 с корректорами
+    // 3-го и 5-го порядка: при уменьшении шага вдвое она падает в 4, 16 и 64 раза.
+    // Наклон берётся на крупных шагах, пока ошибка выше округления
+    struct Expectation {
+        int order;
+        double min_slope;
+    };
+    const Expectation expectations[] = {{0, 1.7}, {3, 3.5}, {5, 5.3}};
+    const double dt = 0.2;
+
+    std::printf("%8s %12s %12s %12s %8s\n", "order", "dt", "dE/E", "dE/E (dt/2)", "slope");
+    bool ok = true;
+    for (const auto& expectation : expectations) {
+        const double coarse = energy_error(expectation.order, dt);
+        const double fine = energy_error(expectation.order, dt * 0.5);
+        const double slope = std::log2(coarse / fine);
+        std::printf("%8d %12g %12.3e %12.3e %8.2f\n", expectation.order, dt, coarse, fine, slope);
+        if (slope < expectation.min_slope) {
+            std::printf("  порядок %d: наклон %.2f меньше ожидаемого %.1f\n", expectation.order, slope,
+                        expectation.min_slope);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
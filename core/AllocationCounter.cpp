@@ -0,0 +1,70 @@
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "core/AllocationCounter.h"
+
+
+#ifdef NBODY_DEBUG_ALLOCATIONS
+
+namespace {
+
+thread_local std::size_t allocation_count = 0;
+
+void* counted_allocate(std::size_t size) {
+  ++allocation_count;
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* counted_allocate(std::size_t size, std::align_val_t alignment) {
+  ++allocation_count;
+  const std::size_t align = static_cast<std::size_t>(alignment);
+  // aligned_alloc требует размер, кратный выравниванию
+  const std::size_t rounded = (size + align - 1) / align * align;
+  if (void* p = std::aligned_alloc(align, rounded ? rounded : align)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+} // namespace
+
+// Массивные и nothrow-варианты по умолчанию вызывают эти две функции
+void* operator new(std::size_t size) {
+  return counted_allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return counted_allocate(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+std::size_t nbody::heap_allocation_count() {
+  return allocation_count;
+}
+
+#else
+
+std::size_t nbody::heap_allocation_count() {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+
+
+namespace nbody {
+
+// Число выделений памяти в куче, сделанных текущим потоком. Считается только в сборке
+// с NBODY_DEBUG_ALLOCATIONS: core/AllocationCounter.cpp заменяет глобальный operator new.
+// Без этого флага всегда 0
+std::size_t heap_allocation_count();
+
+} // namespace nbody
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
+#include <type_traits>
 
 #include "core/Vector.hpp"
 
@@ -8,34 +9,65 @@
 
 namespace nbody {
 
-template <typename T>
+// V -- тип векторов состояния: Vector<T> или выровненный Vector4<T> (core/Vector4.hpp)
+// для кода, которому нужен массив тел, а не отдельные массивы координат.
+// Симуляторы работают с Body<T>. Имя тела хранится в таблице System (System::name),
+// в теле -- только его номер, поэтому Body тривиально копируется
+template <typename T, typename V = Vector<T>>
 class Body {
 public:
     Body() = default;
     
-    Body(T mass, const Vector<T>& position, const Vector<T>& velocity, const std::string& name = "")
-        : mass_(mass), position_(position), velocity_(velocity), name_(name) {}
+    Body(T mass, const V& position, const V& velocity)
+        : mass_(mass), position_(position), velocity_(velocity) {}
     
     T mass() const { return mass_; }
     void set_mass(T mass) { mass_ = mass; }
     
-    const Vector<T>& position() const { return position_; }
-    void set_position(const Vector<T>& position) { position_ = position; }
+    const V& position() const { return position_; }
+    void set_position(const V& position) { position_ = position; }
     
-    const Vector<T>& velocity() const { return velocity_; }
-    void set_velocity(const Vector<T>& velocity) { velocity_ = velocity; }
+    const V& velocity() const { return velocity_; }
+    void set_velocity(const V& velocity) { velocity_ = velocity; }
     
-    Vector<T>& position() { return position_; }
-    Vector<T>& velocity() { return velocity_; }
+    // Радиус тела для обнаружения столкновений; 0 -- точечное тело
+    T radius() const { return radius_; }
+    void set_radius(T radius) { radius_ = radius; }
     
-    const std::string& name() const { return name_; }
-    void set_name(const std::string& name) { name_ = name; }
+    V& position() { return position_; }
+    V& velocity() { return velocity_; }
+    
+    // Номер имени в таблице имён System; 0 -- пустое имя
+    std::uint32_t name_id() const { return name_id_; }
+    void set_name_id(std::uint32_t name_id) { name_id_ = name_id; }
     
 private:
     T mass_{1};
-    Vector<T> position_{};
-    Vector<T> velocity_{};
-    std::string name_{};
+    V position_{};
+    V velocity_{};
+    T radius_{0};
+    std::uint32_t name_id_ = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<Body<double>>, "Body must stay trivially copyable");
+
+// Суммы по телам: масса, sum m * x и импульс sum m * v. Проверки систем (дрейф центра
+// масс и импульса) работают с ними, а не с проходом по телам
+template <typename T, typename V = Vector<T>>
+struct BodyTotals {
+    T mass{0};
+    V mass_position{};
+    V momentum{};
+
+    void add(T body_mass, const V& position, const V& velocity) {
+        mass += body_mass;
+        mass_position.add_scaled(position, body_mass);
+        momentum.add_scaled(velocity, body_mass);
+    }
+
+    V center_of_mass() const {
+        return mass > T{0} ? mass_position / mass : V{};
+    }
 };
 
 } // namespace nbody 
\ No newline at end of file
@@ -1,8 +1,11 @@
 #ifndef DD_H
 #define DD_H
 
+#include <cstdlib>
 #include <iostream>
 
+#include "core/algos.h"
+
 
 
 class DoubleDouble {
@@ -115,4 +118,348 @@ public:
   void print_components() const;
 };
 
+
+// Арифметика определена в заголовке, чтобы компилятор мог встраивать её
+// в горячие циклы Vector<DoubleDouble> и симуляторов
+
+inline DoubleDouble DoubleDouble::add(double a, double b) {
+  double s, e;
+  s = two_sum(a, b, e);
+  return DoubleDouble(s, e);
+}
+
+inline DoubleDouble operator+(const DoubleDouble &a, double b) {
+  double s1, s2;
+  s1 = two_sum(a.hi, b, s2);
+  s2 += a.lo;
+  s1 = two_sum(s1, s2, s2);
+  return DoubleDouble(s1, s2);
+}
+
+inline DoubleDouble operator+(double a, const DoubleDouble &b) {
+  return (b + a);
+}
+
+inline DoubleDouble operator+(const DoubleDouble &a, const DoubleDouble &b) {
+  double s1, s2, t1, t2;
+
+  s1 = two_sum(a.hi, b.hi, s2);
+  t1 = two_sum(a.lo, b.lo, t2);
+  s2 += t1;
+  s1 = two_sum(s1, s2, s2);
+  s2 += t2;
+  s1 = two_sum(s1, s2, s2);
+  return DoubleDouble(s1, s2);
+}
+
+inline DoubleDouble &DoubleDouble::operator+=(double a) {
+  double s1, s2;
+  s1 = two_sum(this->hi, a, s2);
+  s2 += this->lo;
+  this->hi = two_sum(s1, s2, this->lo);
+  return *this;
+}
+
+inline DoubleDouble &DoubleDouble::operator+=(const DoubleDouble &a) {
+  double s1, s2, t1, t2;
+  s1 = two_sum(this->hi, a.hi, s2);
+  t1 = two_sum(this->lo, a.lo, t2);
+  s2 += t1;
+  s1 = two_sum(s1, s2, s2);
+  s2 += t2;
+  this->hi = two_sum(s1, s2, this->lo);
+  return *this;
+}
+
+inline DoubleDouble operator-(const DoubleDouble &a, double b) {
+  double s1, s2;
+  s1 = two_diff(a.hi, b, s2);
+  s2 += a.lo;
+  s1 = two_sum(s1, s2, s2);
+  return DoubleDouble(s1, s2);
+}
+
+inline DoubleDouble operator-(const DoubleDouble &a, const DoubleDouble &b) {
+  double s1, s2, t1, t2;
+  s1 = two_diff(a.hi, b.hi, s2);
+  t1 = two_diff(a.lo, b.lo, t2);
+  s2 += t1;
+  s1 = two_sum(s1, s2, s2);
+  s2 += t2;
+  s1 = two_sum(s1, s2, s2);
+  return DoubleDouble(s1, s2);
+}
+
+inline DoubleDouble operator-(double a, const DoubleDouble &b) {
+  double s1, s2;
+  s1 = two_diff(a, b.hi, s2);
+  s2 -= b.lo;
+  s1 = two_sum(s1, s2, s2);
+  return DoubleDouble(s1, s2);
+}
+
+inline DoubleDouble &DoubleDouble::operator-=(double a) {
+  double s1, s2;
+  s1 = two_diff(this->hi, a, s2);
+  s2 += this->lo;
+  this->hi = two_sum(s1, s2, this->lo);
+  return *this;
+}
+
+inline DoubleDouble &DoubleDouble::operator-=(const DoubleDouble &a) {
+  double s1, s2, t1, t2;
+  s1 = two_diff(this->hi, a.hi, s2);
+  t1 = two_diff(this->lo, a.lo, t2);
+  s2 += t1;
+  s1 = two_sum(s1, s2, s2);
+  s2 += t2;
+  this->hi = two_sum(s1, s2, this->lo);
+  return *this;
+}
+
+inline DoubleDouble DoubleDouble::operator-() const {
+  return DoubleDouble(-this->hi, -this->lo);
+}
+
+inline DoubleDouble operator*(const DoubleDouble &a, double b) {
+  double p1, p2;
+
+  p1 = two_prod(a.hi, b, p2);
+  p2 += (a.lo * b);
+  p1 = two_sum(p1, p2, p2);
+  return DoubleDouble(p1, p2);
+}
+
+inline DoubleDouble operator*(double a, const DoubleDouble &b) {
+  return (b * a);
+}
+
+inline DoubleDouble operator*(const DoubleDouble &a, const DoubleDouble &b) {
+  double p1, p2;
+
+  p1 = two_prod(a.hi, b.hi, p2);
+  p2 += a.hi * b.lo;
+  p2 += a.lo * b.hi;
+  p1 = two_sum(p1, p2, p2);
+  return DoubleDouble(p1, p2);
+}
+
+inline DoubleDouble &DoubleDouble::operator*=(double a) {
+  double p1, p2;
+  p1 = two_prod(this->hi, a, p2);
+  p2 += this->lo * a;
+  this->hi = two_sum(p1, p2, this->lo);
+  return *this;
+}
+
+inline DoubleDouble &DoubleDouble::operator*=(const DoubleDouble &a) {
+  double p1, p2;
+  p1 = two_prod(this->hi, a.hi, p2);
+  p2 += a.lo * this->hi;
+  p2 += a.hi * this->lo;
+  this->hi = two_sum(p1, p2, this->lo);
+  return *this;
+}
+
+inline DoubleDouble operator/(const DoubleDouble &a, double b) {
+
+  double q1, q2;
+  double p1, p2;
+  double s, e;
+  DoubleDouble r;
+  
+  q1 = a.hi / b;   // approx.
+
+  // (s, e) = a - q1 * b
+  p1 = two_prod(q1, b, p2);
+  s = two_diff(a.hi, p1, e);
+  e += a.lo;
+  e -= p2;
+  
+  // approx.
+  q2 = (s + e) / b;
+
+  // renormalize
+  r.hi = two_sum(q1, q2, r.lo);
+
+  return r;
+}
+
+inline DoubleDouble operator/(double a, const DoubleDouble &b) {
+  return DoubleDouble(a) / b;
+}
+
+inline DoubleDouble operator/(const DoubleDouble &a, const DoubleDouble &b) {
+  double q1, q2, q3;
+  DoubleDouble r, t;
+
+  q1 = a.hi / b.hi;  // first approx.
+  r = a - q1 * b;
+  
+  q2 = r.hi / b.hi;  // second approx.
+  r -= (q2 * b);
+
+  q1 = two_sum(q1, q2, q2);
+  q3 = r.hi / b.hi;
+  t = DoubleDouble(q1, q2) + q3;
+  
+  while (q3 > 1e-42) {
+    r -= (q3 * b); 
+    q3 = r.hi / b.hi;
+    t += q3;
+  }
+
+  return t;
+}
+
+inline DoubleDouble inv(const DoubleDouble &a) {
+  return 1.0 / a;
+}
+
+inline DoubleDouble &DoubleDouble::operator/=(double a) {
+  *this = *this / a;
+  return *this;
+}
+
+inline DoubleDouble &DoubleDouble::operator/=(const DoubleDouble &a) {
+  *this = *this / a;
+  return *this;
+}
+
+inline DoubleDouble &DoubleDouble::operator=(double a) {
+  hi = a;
+  lo = 0.0;
+  return *this;
+}
+
+inline DoubleDouble DoubleDouble::square(double a) {
+  double p1, p2;
+  p1 = two_square(a, p2);
+  return DoubleDouble(p1, p2);
+}
+
+inline DoubleDouble square(const DoubleDouble &a) {
+  double p1, p2;
+  double s1, s2;
+  p1 = two_square(a.hi, p2);
+  p2 += 2.0 * a.hi * a.lo;
+  p2 += a.lo * a.lo;
+  s1 = two_sum(p1, p2, s2);
+  return DoubleDouble(s1, s2);
+}
+
+inline bool operator==(const DoubleDouble &a, double b) {
+  return (a.hi == b && a.lo == 0.0);
+}
+
+inline bool operator==(const DoubleDouble &a, const DoubleDouble &b) {
+  return (a.hi == b.hi && a.lo == b.lo);
+}
+
+inline bool operator==(double a, const DoubleDouble &b) {
+  return (a == b.hi && b.lo == 0.0);
+}
+
+inline bool operator>(const DoubleDouble &a, double b) {
+  return (a.hi > b || (a.hi == b && a.lo > 0.0));
+}
+
+inline bool operator>(const DoubleDouble &a, const DoubleDouble &b) {
+  return (a.hi > b.hi || (a.hi == b.hi && a.lo > b.lo));
+}
+
+inline bool operator>(double a, const DoubleDouble &b) {
+  return (a > b.hi || (a == b.hi && b.lo < 0.0));
+}
+
+inline bool operator<(const DoubleDouble &a, double b) {
+  return (a.hi < b || (a.hi == b && a.lo < 0.0));
+}
+
+inline bool operator<(const DoubleDouble &a, const DoubleDouble &b) {
+  return (a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo));
+}
+
+inline bool operator<(double a, const DoubleDouble &b) {
+  return (a < b.hi || (a == b.hi && b.lo > 0.0));
+}
+
+inline bool operator>=(const DoubleDouble &a, double b) {
+  return (a.hi > b || (a.hi == b && a.lo >= 0.0));
+}
+
+inline bool operator>=(const DoubleDouble &a, const DoubleDouble &b) {
+  return (a.hi > b.hi || (a.hi == b.hi && a.lo >= b.lo));
+}
+
+inline bool operator>=(double a, const DoubleDouble &b) {
+  return (b <= a);
+}
+
+inline bool operator<=(const DoubleDouble &a, double b) {
+  return (a.hi < b || (a.hi == b && a.lo <= 0.0));
+}
+
+inline bool operator<=(const DoubleDouble &a, const DoubleDouble &b) {
+  return (a.hi < b.hi || (a.hi == b.hi && a.lo <= b.lo));
+}
+
+inline bool operator<=(double a, const DoubleDouble &b) {
+  return (b >= a);
+}
+
+inline bool operator!=(const DoubleDouble &a, double b) {
+  return (a.hi != b || a.lo != 0.0);
+}
+
+inline bool operator!=(const DoubleDouble &a, const DoubleDouble &b) {
+  return (a.hi != b.hi || a.lo != b.lo);
+}
+
+inline bool operator!=(double a, const DoubleDouble &b) {
+  return (a != b.hi || b.lo != 0.0);
+}
+
+inline bool DoubleDouble::is_zero() const {
+  return (hi == 0.0);
+}
+
+inline bool DoubleDouble::is_negative() const {
+  return (hi < 0.0);
+}
+
+inline bool DoubleDouble::is_positive() const {
+  return (hi > 0.0);
+}
+
+inline DoubleDouble::operator double() const {
+  return hi;
+}
+
+inline DoubleDouble::operator int() const {
+  return (int) hi;
+}
+
+// Квадратный корень
+// Кидает ошибку если a отрицательное
+inline DoubleDouble sqrt(const DoubleDouble &a) {
+  // sqrt(a) = a*x + [a - (a*x)^2] * x / 2   (approx)
+
+  if (a.is_zero())
+    return DoubleDouble(0.0);
+
+  if (a.is_negative()) {
+    std::cerr << "ERROR (DoubleDouble::sqrt): Negative argument." << std::endl;
+    std::exit(-1);
+  }
+
+  double x = 1.0 / std::sqrt(a.hi);
+  double ax = a.hi * x;
+  return DoubleDouble::add(ax, (a - DoubleDouble::square(ax)).hi * (x * 0.5));
+}
+
+inline DoubleDouble abs(const DoubleDouble &a) {
+  return (a.hi < 0.0) ? -a : a;
+}
+
 #endif
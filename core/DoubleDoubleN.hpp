@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+
+#include "core/DoubleDouble.h"
+#include "core/SimdPack.hpp"
+
+
+
+namespace nbody {
+
+// W чисел двойной-двойной точности: старшие и младшие части лежат в отдельных пачках.
+// Алгоритмы те же, что у DoubleDouble, но выполняются сразу для всех элементов;
+// деление и корень не проверяют аргумент на ноль и знак -- это забота вызывающего кода
+template <std::size_t W = simd_width>
+struct DoubleDoubleN {
+    using Pack = DoublePack<W>;
+
+    static constexpr std::size_t width = W;
+
+    Pack hi;
+    Pack lo;
+
+    DoubleDoubleN() : hi(Pack::broadcast(0.0)), lo(Pack::broadcast(0.0)) {}
+    DoubleDoubleN(const Pack& hi, const Pack& lo) : hi(hi), lo(lo) {}
+    explicit DoubleDoubleN(const DoubleDouble& a) : hi(Pack::broadcast(a.hi)), lo(Pack::broadcast(a.lo)) {}
+
+    static DoubleDoubleN load(const double* hi, const double* lo) {
+        return {Pack::load(hi), Pack::load(lo)};
+    }
+
+    void store(double* hi_out, double* lo_out) const {
+        hi.store(hi_out);
+        lo.store(lo_out);
+    }
+
+    // Сумма элементов в DoubleDouble
+    DoubleDouble sum() const {
+        alignas(64) double h[W];
+        alignas(64) double l[W];
+        store(h, l);
+        DoubleDouble result(h[0], l[0]);
+        for (std::size_t k = 1; k < W; ++k) {
+            result += DoubleDouble(h[k], l[k]);
+        }
+        return result;
+    }
+
+    static Pack two_sum(const Pack& a, const Pack& b, Pack& err) {
+        const Pack s = a + b;
+        const Pack bb = s - a;
+        err = (a - (s - bb)) + (b - bb);
+        return s;
+    }
+
+    static Pack two_diff(const Pack& a, const Pack& b, Pack& err) {
+        const Pack s = a - b;
+        const Pack bb = s - a;
+        err = (a - (s - bb)) - (b + bb);
+        return s;
+    }
+
+    static Pack two_prod(const Pack& a, const Pack& b, Pack& err) {
+        const Pack p = a * b;
+        err = Pack::product_error(a, b, p);
+        return p;
+    }
+
+    friend DoubleDoubleN operator+(const DoubleDoubleN& a, const DoubleDoubleN& b) {
+        Pack s2, t2;
+        Pack s1 = two_sum(a.hi, b.hi, s2);
+        const Pack t1 = two_sum(a.lo, b.lo, t2);
+        s2 = s2 + t1;
+        s1 = two_sum(s1, s2, s2);
+        s2 = s2 + t2;
+        s1 = two_sum(s1, s2, s2);
+        return {s1, s2};
+    }
+
+    friend DoubleDoubleN operator+(const DoubleDoubleN& a, const Pack& b) {
+        Pack s2;
+        Pack s1 = two_sum(a.hi, b, s2);
+        s2 = s2 + a.lo;
+        s1 = two_sum(s1, s2, s2);
+        return {s1, s2};
+    }
+
+    friend DoubleDoubleN operator-(const DoubleDoubleN& a, const DoubleDoubleN& b) {
+        Pack s2, t2;
+        Pack s1 = two_diff(a.hi, b.hi, s2);
+        const Pack t1 = two_diff(a.lo, b.lo, t2);
+        s2 = s2 + t1;
+        s1 = two_sum(s1, s2, s2);
+        s2 = s2 + t2;
+        s1 = two_sum(s1, s2, s2);
+        return {s1, s2};
+    }
+
+    friend DoubleDoubleN operator-(const DoubleDoubleN& a) {
+        return {-a.hi, -a.lo};
+    }
+
+    friend DoubleDoubleN operator*(const DoubleDoubleN& a, const DoubleDoubleN& b) {
+        Pack p2;
+        Pack p1 = two_prod(a.hi, b.hi, p2);
+        p2 = p2 + a.hi * b.lo;
+        p2 = p2 + a.lo * b.hi;
+        p1 = two_sum(p1, p2, p2);
+        return {p1, p2};
+    }
+
+    friend DoubleDoubleN operator*(const DoubleDoubleN& a, const Pack& b) {
+        Pack p2;
+        Pack p1 = two_prod(a.hi, b, p2);
+        p2 = p2 + a.lo * b;
+        p1 = two_sum(p1, p2, p2);
+        return {p1, p2};
+    }
+
+    // Три приближения частного без итераций до сходимости, как в библиотеке QD
+    friend DoubleDoubleN operator/(const DoubleDoubleN& a, const DoubleDoubleN& b) {
+        Pack q1 = a.hi / b.hi;
+        DoubleDoubleN r = a - b * q1;
+
+        Pack q2 = r.hi / b.hi;
+        r = r - b * q2;
+
+        const Pack q3 = r.hi / b.hi;
+        q1 = two_sum(q1, q2, q2);
+        return DoubleDoubleN(q1, q2) + q3;
+    }
+
+    DoubleDoubleN& operator+=(const DoubleDoubleN& a) {
+        return *this = *this + a;
+    }
+
+    DoubleDoubleN& operator-=(const DoubleDoubleN& a) {
+        return *this = *this - a;
+    }
+
+    DoubleDoubleN& operator*=(const DoubleDoubleN& a) {
+        return *this = *this * a;
+    }
+
+    // sqrt(a) = a*x + [a - (a*x)^2] * x / 2, x = 1/sqrt(a.hi); a > 0
+    friend DoubleDoubleN sqrt(const DoubleDoubleN& a) {
+        const Pack x = Pack::broadcast(1.0) / sqrt(a.hi);
+        const Pack ax = a.hi * x;
+        Pack err;
+        const Pack square_hi = two_prod(ax, ax, err);
+        const Pack correction = (a - DoubleDoubleN(square_hi, err)).hi * (x * Pack::broadcast(0.5));
+        const Pack s = two_sum(ax, correction, err);
+        return {s, err};
+    }
+};
+
+} // namespace nbody
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "core/Vector.hpp"
+
+
+
+namespace nbody {
+
+// Набор кеплеровских орбит в SoA-раскладке
+template <typename T>
+struct KeplerOrbits {
+    std::vector<T> x, y, z;
+    std::vector<T> vx, vy, vz;
+    std::vector<T> mu;  // Гравитационный параметр G*M центрального тела
+
+    std::size_t size() const { return x.size(); }
+
+    void resize(std::size_t n) {
+        x.resize(n); y.resize(n); z.resize(n);
+        vx.resize(n); vy.resize(n); vz.resize(n);
+        mu.resize(n);
+    }
+
+    void clear() {
+        resize(0);
+    }
+
+    void set(std::size_t i, const Vector<T>& position, const Vector<T>& velocity, T gm) {
+        x[i] = position.x(); y[i] = position.y(); z[i] = position.z();
+        vx[i] = velocity.x(); vy[i] = velocity.y(); vz[i] = velocity.z();
+        mu[i] = gm;
+    }
+
+    void push_back(const Vector<T>& position, const Vector<T>& velocity, T gm) {
+        resize(size() + 1);
+        set(size() - 1, position, velocity, gm);
+    }
+
+    Vector<T> position(std::size_t i) const { return Vector<T>(x[i], y[i], z[i]); }
+    Vector<T> velocity(std::size_t i) const { return Vector<T>(vx[i], vy[i], vz[i]); }
+};
+
+// Пакетное решение задачи двух тел в универсальных переменных (Danby, 1988)
+// Подходит для любых эксцентриситетов. Орбиты обрабатываются блоками по lanes штук
+// без ветвлений внутри блока, чтобы итерации Галлея векторизовались; не сошедшиеся
+// орбиты досчитываются скалярным методом Ньютона в вилке. Большие наборы делятся между потоками.
+template <typename T>
+class KeplerPropagator {
+public:
+    static constexpr std::size_t lanes = 8;
+    static constexpr std::size_t parallel_threshold = 4096;
+
+    KeplerPropagator() : thread_count_(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    void set_thread_count(unsigned count) {
+        thread_count_ = std::max(1u, count);
+    }
+
+    unsigned thread_count() const {
+        return thread_count_;
+    }
+
+    // Продвижение всех орбит на общий шаг dt
+    void propagate(KeplerOrbits<T>& orbits, T dt) const {
+        for_each_range(orbits.size(), [&](std::size_t begin, std::size_t end) {
+            propagate_range(orbits, &dt, 0, begin, end);
+        });
+    }
+
+    // Продвижение каждой орбиты на собственный шаг dt[i]
+    void propagate(KeplerOrbits<T>& orbits, const std::vector<T>& dt) const {
+        for_each_range(orbits.size(), [&](std::size_t begin, std::size_t end) {
+            propagate_range(orbits, dt.data() + begin, 1, begin, end);
+        });
+    }
+
+    // Продвижение одной орбиты
+    static void propagate(Vector<T>& position, Vector<T>& velocity, T mu, T dt) {
+        propagate_block(&position.x(), &position.y(), &position.z(),
+                        &velocity.x(), &velocity.y(), &velocity.z(),
+                        &mu, &dt, 0, 1);
+    }
+
+    // Состояние в перицентре по кеплеровским элементам (углы в радианах)
+    static void pericenter_state(T mu, T a, T e, T inclination, T arg_periapsis, T ascending_node,
+                                 Vector<T>& position, Vector<T>& velocity) {
+        const T co = cos(arg_periapsis), so = sin(arg_periapsis);
+        const T cn = cos(ascending_node), sn = sin(ascending_node);
+        const T ci = cos(inclination), si = sin(inclination);
+
+        // Направление на перицентр и перпендикулярное ему в плоскости орбиты
+        const Vector<T> p(co * cn - so * sn * ci, co * sn + so * cn * ci, so * si);
+        const Vector<T> q(-so * cn - co * sn * ci, -so * sn + co * cn * ci, co * si);
+
+        const T r_p = a * (T{1} - e);
+        const T v_p = sqrt(mu * (T{1} + e) / r_p);
+        position = p * r_p;
+        velocity = q * v_p;
+    }
+
+    // Время, прошедшее от перицентра до заданной средней аномалии
+    static T time_since_pericenter(T mu, T a, T mean_anomaly) {
+        return mean_anomaly / sqrt(mu / (a * a * a));
+    }
+
+    // Декартово состояние по кеплеровским элементам (углы в радианах)
+    static void from_elements(T mu, T a, T e, T inclination, T arg_periapsis, T ascending_node,
+                              T mean_anomaly, Vector<T>& position, Vector<T>& velocity) {
+        pericenter_state(mu, a, e, inclination, arg_periapsis, ascending_node, position, velocity);
+        propagate(position, velocity, mu, time_since_pericenter(mu, a, mean_anomaly));
+    }
+
+private:
+    static constexpr int max_halley_iterations = 12;
+    static constexpr int max_fallback_iterations = 200;
+
+    static T tolerance() {
+        return std::numeric_limits<T>::is_specialized
+            ? T{4} * std::numeric_limits<T>::epsilon()
+            : T{1e-30};
+    }
+
+    template <typename F>
+    void for_each_range(std::size_t n, F&& f) const {
+        const std::size_t workers = std::min<std::size_t>(thread_count_, n / parallel_threshold);
+        if (workers <= 1) {
+            f(std::size_t{0}, n);
+            return;
+        }
+
+        std::size_t chunk = (n + workers - 1) / workers;
+        chunk = (chunk + lanes - 1) / lanes * lanes;
+
+        std::vector<std::thread> threads;
+        for (std::size_t begin = chunk; begin < n; begin += chunk) {
+            threads.emplace_back(f, begin, std::min(n, begin + chunk));
+        }
+        f(std::size_t{0}, std::min(n, chunk));
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    static void propagate_range(KeplerOrbits<T>& o, const T* dt, std::size_t dt_stride,
+                                std::size_t begin, std::size_t end) {
+        for (std::size_t first = begin; first < end; first += lanes) {
+            const std::size_t count = std::min(lanes, end - first);
+            propagate_block(o.x.data() + first, o.y.data() + first, o.z.data() + first,
+                            o.vx.data() + first, o.vy.data() + first, o.vz.data() + first,
+                            o.mu.data() + first, dt + (first - begin) * dt_stride, dt_stride, count);
+        }
+    }
+
+    static void propagate_block(T* x, T* y, T* z, T* vx, T* vy, T* vz,
+                                const T* mu, const T* dt, std::size_t dt_stride, std::size_t count) {
+        using std::abs;
+
+        std::array<T, lanes> r0, eta0, beta, zeta0, t, s;
+        std::array<T, lanes> arg{}, c0, c1, c2, c3;
+        std::array<bool, lanes> converged;
+
+        for (std::size_t l = 0; l < count; ++l) {
+            r0[l] = sqrt(x[l] * x[l] + y[l] * y[l] + z[l] * z[l]);
+            eta0[l] = x[l] * vx[l] + y[l] * vy[l] + z[l] * vz[l];
+            const T v2 = vx[l] * vx[l] + vy[l] * vy[l] + vz[l] * vz[l];
+            beta[l] = T{2} * mu[l] / r0[l] - v2;
+            zeta0[l] = mu[l] - beta[l] * r0[l];
+            t[l] = reduce_period(dt[l * dt_stride], beta[l], mu[l]);
+            s[l] = initial_guess(t[l], r0[l], eta0[l], beta[l], mu[l]);
+            converged[l] = false;
+        }
+
+        const T tol = tolerance();
+        for (int iter = 0; iter < max_halley_iterations; ++iter) {
+            for (std::size_t l = 0; l < count; ++l) {
+                arg[l] = beta[l] * s[l] * s[l];
+            }
+            stumpff(arg, count, c0, c1, c2, c3);
+
+            bool all_converged = true;
+            for (std::size_t l = 0; l < count; ++l) {
+                const T g1 = s[l] * c1[l];
+                const T g2 = s[l] * s[l] * c2[l];
+                const T g3 = s[l] * s[l] * s[l] * c3[l];
+                const T f = r0[l] * g1 + eta0[l] * g2 + mu[l] * g3 - t[l];
+                const T fp = r0[l] * c0[l] + eta0[l] * g1 + mu[l] * g2;
+                const T fpp = eta0[l] * c0[l] + zeta0[l] * g1;
+
+                const T ds = -T{2} * f * fp / (T{2} * fp * fp - f * fpp);
+                s[l] += ds;
+                converged[l] = abs(ds) <= tol * abs(s[l]);
+                all_converged = all_converged && converged[l];
+            }
+            if (all_converged) {
+                break;
+            }
+        }
+
+        for (std::size_t l = 0; l < count; ++l) {
+            if (!converged[l] || !(abs(s[l]) < std::numeric_limits<double>::max())) {
+                s[l] = solve_bracketed(t[l], r0[l], eta0[l], beta[l], mu[l]);
+            }
+            arg[l] = beta[l] * s[l] * s[l];
+        }
+        stumpff(arg, count, c0, c1, c2, c3);
+
+        for (std::size_t l = 0; l < count; ++l) {
+            const T g1 = s[l] * c1[l];
+            const T g2 = s[l] * s[l] * c2[l];
+            const T g3 = s[l] * s[l] * s[l] * c3[l];
+            const T r = r0[l] * c0[l] + eta0[l] * g1 + mu[l] * g2;
+
+            const T f = T{1} - mu[l] * g2 / r0[l];
+            const T g = t[l] - mu[l] * g3;
+            const T fdot = -mu[l] * g1 / (r0[l] * r);
+            const T gdot = T{1} - mu[l] * g2 / r;
+
+            const T nx = f * x[l] + g * vx[l];
+            const T ny = f * y[l] + g * vy[l];
+            const T nz = f * z[l] + g * vz[l];
+            vx[l] = fdot * x[l] + gdot * vx[l];
+            vy[l] = fdot * y[l] + gdot * vy[l];
+            vz[l] = fdot * z[l] + gdot * vz[l];
+            x[l] = nx;
+            y[l] = ny;
+            z[l] = nz;
+        }
+    }
+
+    // Для эллиптических орбит отбрасываем целое число периодов, приводя шаг к (-P/2, P/2]
+    static T reduce_period(T dt, T beta, T mu) {
+        using std::abs;
+        using std::floor;
+
+        if (beta <= T{0}) {
+            return dt;
+        }
+        const T period = T{2} * T{M_PI} * mu / (beta * sqrt(beta));
+        if (abs(dt) <= period * T{0.5}) {
+            return dt;
+        }
+        return dt - period * floor(dt / period + T{0.5});
+    }
+
+    // Короткие шаги: разложение по времени; длинные эллиптические: приращение средней аномалии;
+    // длинные гиперболические: решение уравнения Кеплера для гиперболической аномалии
+    static T initial_guess(T dt, T r0, T eta0, T beta, T mu) {
+        using std::abs;
+        using std::cbrt;
+
+        if (abs(dt * eta0) < r0 * r0) {
+            return dt / r0 - dt * dt * eta0 / (T{2} * r0 * r0 * r0);
+        }
+        if (beta > T{0}) {
+            return dt * beta / mu;
+        }
+        if (beta < T{0}) {
+            const T dm = -beta * sqrt(-beta) * dt / mu;
+            return T{hyperbolic_anomaly_change(double(dm), double(r0), double(eta0),
+                                               double(beta), double(mu))} / sqrt(-beta);
+        }
+        return T{cbrt(6.0 * double(dt / mu))};
+    }
+
+    // Приращение гиперболической аномалии при изменении средней аномалии на dm;
+    // нужно только как начальное приближение, поэтому считается в double
+    static double hyperbolic_anomaly_change(double dm, double r0, double eta0, double beta, double mu) {
+        const double e_cosh = 1.0 - r0 * beta / mu;
+        const double e_sinh = eta0 * std::sqrt(-beta) / mu;
+        const double e = std::sqrt(std::max(e_cosh * e_cosh - e_sinh * e_sinh, 1.0));
+        const double h0 = std::asinh(e_sinh / e);
+        const double m1 = e_sinh - h0 + dm;
+
+        // e*sinh(H) - H монотонна и нечётна, корень лежит в вилке [-bound, bound]
+        double bound = 1.0;
+        while (e * std::sinh(bound) - bound < std::abs(m1)) {
+            bound *= 2.0;
+        }
+        double lo = -bound, hi = bound;
+        double h1 = m1 > 0.0 ? std::log(2.0 * m1 / e + 1.8) : -std::log(-2.0 * m1 / e + 1.8);
+        for (int iter = 0; iter < max_fallback_iterations; ++iter) {
+            const double f = e * std::sinh(h1) - h1 - m1;
+            if (f < 0.0) lo = h1; else hi = h1;
+            double next = h1 - f / (e * std::cosh(h1) - 1.0);
+            if (!(next > lo && next < hi)) {
+                next = 0.5 * (lo + hi);
+            }
+            const bool done = std::abs(next - h1) <= 1e-12 * std::max(1.0, std::abs(next));
+            h1 = next;
+            if (done) {
+                break;
+            }
+        }
+        return h1 - h0;
+    }
+
+    // Запасной метод: время монотонно растёт по универсальной переменной (dt/ds = r > 0),
+    // поэтому шаги Ньютона страхуются бисекцией внутри вилки
+    static T solve_bracketed(T dt, T r0, T eta0, T beta, T mu) {
+        using std::abs;
+
+        if (dt == T{0}) {
+            return T{0};
+        }
+
+        std::array<T, lanes> arg{}, c0, c1, c2, c3;
+        T f, fp;
+        auto residual = [&](T s) {
+            arg[0] = beta * s * s;
+            stumpff(arg, 1, c0, c1, c2, c3);
+            f = r0 * s * c1[0] + eta0 * s * s * c2[0] + mu * s * s * s * c3[0] - dt;
+            fp = r0 * c0[0] + eta0 * s * c1[0] + mu * s * s * c2[0];
+        };
+
+        T s = initial_guess(dt, r0, eta0, beta, mu);
+        T lo = T{0}, hi = T{0};
+        if (dt > T{0}) {
+            hi = s > T{0} ? s : dt / r0;
+            for (residual(hi); f < T{0}; residual(hi)) {
+                lo = hi;
+                hi = hi * T{2};
+            }
+        } else {
+            lo = s < T{0} ? s : dt / r0;
+            for (residual(lo); f > T{0}; residual(lo)) {
+                hi = lo;
+                lo = lo * T{2};
+            }
+        }
+
+        const T tol = tolerance();
+        if (!(s > lo && s < hi)) {
+            s = (lo + hi) * T{0.5};
+        }
+        T last_step = hi - lo;
+        for (int iter = 0; iter < max_fallback_iterations; ++iter) {
+            residual(s);
+            if (f < T{0}) lo = s; else hi = s;
+            // Бисекция, если Ньютон выходит из вилки или сходится медленнее неё
+            T next = s - f / fp;
+            if (!(next > lo && next < hi) || abs(T{2} * f) > abs(last_step * fp)) {
+                next = (lo + hi) * T{0.5};
+            }
+            last_step = next - s;
+            const bool done = abs(last_step) <= tol * abs(next) || !(hi - lo > tol * abs(s));
+            s = next;
+            if (done) {
+                break;
+            }
+        }
+        return s;
+    }
+
+    // Функции Штумпфа c0..c3: ряды для малого аргумента и формулы учетверения.
+    // Число учетверений у орбит блока разное, поэтому они применяются с маской
+    static void stumpff(const std::array<T, lanes>& z_in, std::size_t count,
+                        std::array<T, lanes>& c0, std::array<T, lanes>& c1,
+                        std::array<T, lanes>& c2, std::array<T, lanes>& c3) {
+        using std::abs;
+
+        constexpr int terms = std::numeric_limits<T>::is_specialized ? 8 : 13;
+
+        std::array<T, lanes> z;
+        std::array<int, lanes> reductions;
+        int max_reductions = 0;
+        for (std::size_t l = 0; l < count; ++l) {
+            z[l] = z_in[l];
+            reductions[l] = 0;
+            while (abs(z[l]) > T{0.1}) {
+                z[l] = z[l] * T{0.25};
+                ++reductions[l];
+            }
+            max_reductions = std::max(max_reductions, reductions[l]);
+        }
+
+        for (std::size_t l = 0; l < count; ++l) {
+            T s2 = T{1};
+            T s3 = T{1};
+            for (int k = terms; k > 0; --k) {
+                s2 = T{1} - z[l] * s2 / T{double((2 * k + 1) * (2 * k + 2))};
+                s3 = T{1} - z[l] * s3 / T{double((2 * k + 2) * (2 * k + 3))};
+            }
+            c2[l] = s2 / T{2};
+            c3[l] = s3 / T{6};
+            c1[l] = T{1} - z[l] * c3[l];
+            c0[l] = T{1} - z[l] * c2[l];
+        }
+
+        for (int k = 0; k < max_reductions; ++k) {
+            for (std::size_t l = 0; l < count; ++l) {
+                const bool active = k < reductions[l];
+                const T n3 = (c2[l] + c0[l] * c3[l]) * T{0.25};
+                const T n2 = c1[l] * c1[l] * T{0.5};
+                const T n1 = c0[l] * c1[l];
+                const T n0 = T{2} * c0[l] * c0[l] - T{1};
+                c3[l] = active ? n3 : c3[l];
+                c2[l] = active ? n2 : c2[l];
+                c1[l] = active ? n1 : c1[l];
+                c0[l] = active ? n0 : c0[l];
+            }
+        }
+    }
+
+    unsigned thread_count_;
+};
+
+} // namespace nbody
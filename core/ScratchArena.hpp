@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+
+
+namespace nbody {
+
+// Временные буферы шага, по пулу на каждый тип элементов из Types. Буферы выдаются по
+// порядку запросов и возвращаются все сразу вызовом reset() в начале шага; шаг,
+// запрашивающий буферы в том же порядке и того же размера, получает уже выделенную
+// память, и куча не затрагивается. Тип буфера выбирает пул на этапе компиляции
+template <typename... Types>
+class ScratchArena {
+public:
+    ScratchArena() = default;
+
+    // Копия начинается с пустой арены: буферы не разделяются между владельцами
+    ScratchArena(const ScratchArena&) {}
+    ScratchArena& operator=(const ScratchArena&) { return *this; }
+
+    // Следующий буфер из n элементов U; содержимое не определено
+    template <typename U>
+    std::vector<U>& buffer(std::size_t n) {
+        static_assert((std::is_same_v<U, Types> || ...), "ScratchArena has no pool for this type");
+        auto& pool = std::get<Pool<U>>(pools_);
+        if (pool.next == pool.buffers.size()) {
+            pool.buffers.emplace_back();
+        }
+
+        auto& data = pool.buffers[pool.next++];
+        data.resize(n);
+        return data;
+    }
+
+    void reset() {
+        std::apply([](auto&... pool) { ((pool.next = 0), ...); }, pools_);
+    }
+
+    // Область, при выходе из которой запрошенные в ней буферы возвращаются арене:
+    // для запросов вне шага (например, WisdomHolmanSimulator::synchronize), чтобы
+    // повторные вызовы между шагами не добавляли буферов
+    class Scope {
+    public:
+        explicit Scope(ScratchArena& arena) : arena_(arena), marks_(arena.marks()) {}
+        ~Scope() { arena_.rewind(marks_); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ScratchArena& arena_;
+        std::array<std::size_t, sizeof...(Types)> marks_;
+    };
+
+    Scope scope() {
+        return Scope(*this);
+    }
+
+    std::size_t size() const {
+        return std::apply([](const auto&... pool) { return (std::size_t{0} + ... + pool.buffers.size()); }, pools_);
+    }
+
+private:
+    // deque: выданные ссылки на буферы не меняются при добавлении новых
+    template <typename U>
+    struct Pool {
+        std::deque<std::vector<U>> buffers;
+        std::size_t next = 0;
+    };
+
+    std::array<std::size_t, sizeof...(Types)> marks() const {
+        return std::apply([](const auto&... pool) { return std::array<std::size_t, sizeof...(Types)>{pool.next...}; },
+                          pools_);
+    }
+
+    void rewind(const std::array<std::size_t, sizeof...(Types)>& marks) {
+        std::apply([&marks](auto&... pool) {
+            std::size_t index = 0;
+            ((pool.next = marks[index++]), ...);
+        }, pools_);
+    }
+
+    std::tuple<Pool<Types>...> pools_;
+};
+
+} // namespace nbody
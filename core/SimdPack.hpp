@@ -0,0 +1,335 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "core/algos.h"
+
+
+
+namespace nbody {
+
+// Пачка из W чисел S (double или float) с поэлементными операциями. Общий вариант --
+// циклы по массиву; для AVX (double при наличии FMA) и AVX-512 ниже есть специализации
+// на регистрах
+template <typename S, std::size_t W>
+struct SimdPack {
+    std::array<S, W> v;
+
+    static SimdPack broadcast(S x) {
+        SimdPack r;
+        r.v.fill(x);
+        return r;
+    }
+
+    static SimdPack load(const S* p) {
+        SimdPack r;
+        for (std::size_t k = 0; k < W; ++k) {
+            r.v[k] = p[k];
+        }
+        return r;
+    }
+
+    void store(S* p) const {
+        for (std::size_t k = 0; k < W; ++k) {
+            p[k] = v[k];
+        }
+    }
+
+    // Точная ошибка произведения a*b - p, где p = a*b (только для double)
+    static SimdPack product_error(const SimdPack& a, const SimdPack& b, const SimdPack&) {
+        SimdPack r;
+        for (std::size_t k = 0; k < W; ++k) {
+            two_prod(a.v[k], b.v[k], r.v[k]);
+        }
+        return r;
+    }
+
+    // a*b + c; в специализациях -- одной инструкцией FMA, где она есть
+    static SimdPack multiply_add(const SimdPack& a, const SimdPack& b, const SimdPack& c) {
+        SimdPack r;
+        for (std::size_t k = 0; k < W; ++k) {
+            r.v[k] = a.v[k] * b.v[k] + c.v[k];
+        }
+        return r;
+    }
+
+    // 1 в элементах, где a < threshold, и 0 в остальных
+    static SimdPack less(const SimdPack& a, S threshold) {
+        SimdPack r;
+        for (std::size_t k = 0; k < W; ++k) {
+            r.v[k] = a.v[k] < threshold ? S{1} : S{0};
+        }
+        return r;
+    }
+
+    friend SimdPack sqrt(const SimdPack& a) {
+        SimdPack r;
+        for (std::size_t k = 0; k < W; ++k) {
+            r.v[k] = std::sqrt(a.v[k]);
+        }
+        return r;
+    }
+
+#define NBODY_PACK_OPERATOR(op)                                            \
+    friend SimdPack operator op(const SimdPack& a, const SimdPack& b) {     \
+        SimdPack r;                                                        \
+        for (std::size_t k = 0; k < W; ++k) {                              \
+            r.v[k] = a.v[k] op b.v[k];                                     \
+        }                                                                  \
+        return r;                                                          \
+    }
+    NBODY_PACK_OPERATOR(+)
+    NBODY_PACK_OPERATOR(-)
+    NBODY_PACK_OPERATOR(*)
+    NBODY_PACK_OPERATOR(/)
+#undef NBODY_PACK_OPERATOR
+
+    friend SimdPack operator-(const SimdPack& a) {
+        SimdPack r;
+        for (std::size_t k = 0; k < W; ++k) {
+            r.v[k] = -a.v[k];
+        }
+        return r;
+    }
+};
+
+#if defined(__AVX__) && defined(__FMA__)
+template <>
+struct SimdPack<double, 4> {
+    __m256d v;
+
+    static SimdPack broadcast(double x) {
+        return {_mm256_set1_pd(x)};
+    }
+
+    static SimdPack load(const double* p) {
+        return {_mm256_loadu_pd(p)};
+    }
+
+    void store(double* p) const {
+        _mm256_storeu_pd(p, v);
+    }
+
+    static SimdPack product_error(const SimdPack& a, const SimdPack& b, const SimdPack& p) {
+        return {_mm256_fmsub_pd(a.v, b.v, p.v)};
+    }
+
+    static SimdPack multiply_add(const SimdPack& a, const SimdPack& b, const SimdPack& c) {
+        return {_mm256_fmadd_pd(a.v, b.v, c.v)};
+    }
+
+    static SimdPack less(const SimdPack& a, double threshold) {
+        const __m256d mask = _mm256_cmp_pd(a.v, _mm256_set1_pd(threshold), _CMP_LT_OQ);
+        return {_mm256_and_pd(mask, _mm256_set1_pd(1.0))};
+    }
+
+    friend SimdPack sqrt(const SimdPack& a) {
+        return {_mm256_sqrt_pd(a.v)};
+    }
+
+    friend SimdPack operator+(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_add_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_sub_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator*(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_mul_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator/(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_div_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a) {
+        return {_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))};
+    }
+};
+#endif
+
+#if defined(__AVX__)
+template <>
+struct SimdPack<float, 8> {
+    __m256 v;
+
+    static SimdPack broadcast(float x) {
+        return {_mm256_set1_ps(x)};
+    }
+
+    static SimdPack load(const float* p) {
+        return {_mm256_loadu_ps(p)};
+    }
+
+    void store(float* p) const {
+        _mm256_storeu_ps(p, v);
+    }
+
+    static SimdPack multiply_add(const SimdPack& a, const SimdPack& b, const SimdPack& c) {
+#if defined(__FMA__)
+        return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+#else
+        return {_mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v)};
+#endif
+    }
+
+    static SimdPack less(const SimdPack& a, float threshold) {
+        const __m256 mask = _mm256_cmp_ps(a.v, _mm256_set1_ps(threshold), _CMP_LT_OQ);
+        return {_mm256_and_ps(mask, _mm256_set1_ps(1.0f))};
+    }
+
+    friend SimdPack sqrt(const SimdPack& a) {
+        return {_mm256_sqrt_ps(a.v)};
+    }
+
+    friend SimdPack operator+(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_add_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_sub_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator*(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_mul_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator/(const SimdPack& a, const SimdPack& b) {
+        return {_mm256_div_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a) {
+        return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))};
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+template <>
+struct SimdPack<double, 8> {
+    __m512d v;
+
+    static SimdPack broadcast(double x) {
+        return {_mm512_set1_pd(x)};
+    }
+
+    static SimdPack load(const double* p) {
+        return {_mm512_loadu_pd(p)};
+    }
+
+    void store(double* p) const {
+        _mm512_storeu_pd(p, v);
+    }
+
+    static SimdPack product_error(const SimdPack& a, const SimdPack& b, const SimdPack& p) {
+        return {_mm512_fmsub_pd(a.v, b.v, p.v)};
+    }
+
+    static SimdPack multiply_add(const SimdPack& a, const SimdPack& b, const SimdPack& c) {
+        return {_mm512_fmadd_pd(a.v, b.v, c.v)};
+    }
+
+    static SimdPack less(const SimdPack& a, double threshold) {
+        const __mmask8 mask = _mm512_cmp_pd_mask(a.v, _mm512_set1_pd(threshold), _CMP_LT_OQ);
+        return {_mm512_maskz_mov_pd(mask, _mm512_set1_pd(1.0))};
+    }
+
+    friend SimdPack sqrt(const SimdPack& a) {
+        // maskz-вариант: _mm512_sqrt_pd в GCC 12 даёт ложное -Wmaybe-uninitialized
+        return {_mm512_maskz_sqrt_pd(__mmask8(0xFF), a.v)};
+    }
+
+    friend SimdPack operator+(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_add_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_sub_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator*(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_mul_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator/(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_div_pd(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a) {
+        return {_mm512_sub_pd(_mm512_setzero_pd(), a.v)};
+    }
+};
+
+template <>
+struct SimdPack<float, 16> {
+    __m512 v;
+
+    static SimdPack broadcast(float x) {
+        return {_mm512_set1_ps(x)};
+    }
+
+    static SimdPack load(const float* p) {
+        return {_mm512_loadu_ps(p)};
+    }
+
+    void store(float* p) const {
+        _mm512_storeu_ps(p, v);
+    }
+
+    static SimdPack multiply_add(const SimdPack& a, const SimdPack& b, const SimdPack& c) {
+        return {_mm512_fmadd_ps(a.v, b.v, c.v)};
+    }
+
+    static SimdPack less(const SimdPack& a, float threshold) {
+        const __mmask16 mask = _mm512_cmp_ps_mask(a.v, _mm512_set1_ps(threshold), _CMP_LT_OQ);
+        return {_mm512_maskz_mov_ps(mask, _mm512_set1_ps(1.0f))};
+    }
+
+    friend SimdPack sqrt(const SimdPack& a) {
+        return {_mm512_maskz_sqrt_ps(__mmask16(0xFFFF), a.v)};
+    }
+
+    friend SimdPack operator+(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_add_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_sub_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator*(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_mul_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator/(const SimdPack& a, const SimdPack& b) {
+        return {_mm512_div_ps(a.v, b.v)};
+    }
+
+    friend SimdPack operator-(const SimdPack& a) {
+        return {_mm512_sub_ps(_mm512_setzero_ps(), a.v)};
+    }
+};
+#endif
+
+template <std::size_t W>
+using DoublePack = SimdPack<double, W>;
+
+template <std::size_t W>
+using FloatPack = SimdPack<float, W>;
+
+// Число double, которое целевой процессор обрабатывает одной инструкцией; float -- вдвое больше
+#if defined(__AVX512F__)
+inline constexpr std::size_t simd_width = 8;
+#else
+inline constexpr std::size_t simd_width = 4;
+#endif
+inline constexpr std::size_t float_simd_width = 2 * simd_width;
+
+} // namespace nbody
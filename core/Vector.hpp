@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <iostream>
@@ -12,22 +13,27 @@
 
 namespace nbody {
 
-template <typename T>
+// Вектор размерности D; D = 2 -- для плоских систем, где компонента z всегда нулевая
+template <typename T, std::size_t D = 3>
 class Vector {
+    static_assert(D == 2 || D == 3, "Only planar and spatial vectors are supported");
+
 public:
-    static constexpr std::size_t dimensions = 3;
+    static constexpr std::size_t dimensions = D;
     
     Vector() : data_{} {}
     
-    Vector(T x, T y, T z) : data_{x, y, z} {}
+    Vector(T x, T y, T z) requires (D == 3) : data_{x, y, z} {}
+
+    Vector(T x, T y) requires (D == 2) : data_{x, y} {}
     
     T& x() { return data_[0]; }
     T& y() { return data_[1]; }
-    T& z() { return data_[2]; }
+    T& z() requires (D == 3) { return data_[2]; }
     
     const T& x() const { return data_[0]; }
     const T& y() const { return data_[1]; }
-    const T& z() const { return data_[2]; }
+    const T& z() const requires (D == 3) { return data_[2]; }
     
     T& operator[](std::size_t index) { return data_[index]; }
     const T& operator[](std::size_t index) const { return data_[index]; }
@@ -59,7 +65,23 @@ public:
         }
         return *this;
     }
-    
+
+    // this += other * scalar без промежуточного вектора (axpy)
+    Vector& add_scaled(const Vector& other, T scalar) {
+        for (std::size_t i = 0; i < dimensions; ++i) {
+            data_[i] += other.data_[i] * scalar;
+        }
+        return *this;
+    }
+
+    // this = a + b * scalar без промежуточных векторов
+    Vector& fma_assign(const Vector& a, const Vector& b, T scalar) {
+        for (std::size_t i = 0; i < dimensions; ++i) {
+            data_[i] = a.data_[i] + b.data_[i] * scalar;
+        }
+        return *this;
+    }
+
     T magnitude_squared() const {
         T result{};
         for (const auto& component : data_) {
@@ -91,43 +113,43 @@ private:
     std::array<T, dimensions> data_;
 };
 
-template <typename T>
-Vector<T> operator+(const Vector<T>& lhs, const Vector<T>& rhs) {
-    Vector<T> result = lhs;
+template <typename T, std::size_t D>
+Vector<T, D> operator+(const Vector<T, D>& lhs, const Vector<T, D>& rhs) {
+    Vector<T, D> result = lhs;
     result += rhs;
     return result;
 }
 
-template <typename T>
-Vector<T> operator-(const Vector<T>& lhs, const Vector<T>& rhs) {
-    Vector<T> result = lhs;
+template <typename T, std::size_t D>
+Vector<T, D> operator-(const Vector<T, D>& lhs, const Vector<T, D>& rhs) {
+    Vector<T, D> result = lhs;
     result -= rhs;
     return result;
 }
 
-template <typename T>
-Vector<T> operator*(const Vector<T>& vec, T scalar) {
-    Vector<T> result = vec;
+template <typename T, std::size_t D>
+Vector<T, D> operator*(const Vector<T, D>& vec, T scalar) {
+    Vector<T, D> result = vec;
     result *= scalar;
     return result;
 }
 
-template <typename T>
-Vector<T> operator*(T scalar, const Vector<T>& vec) {
+template <typename T, std::size_t D>
+Vector<T, D> operator*(T scalar, const Vector<T, D>& vec) {
     return vec * scalar;
 }
 
-template <typename T>
-Vector<T> operator/(const Vector<T>& vec, T scalar) {
-    Vector<T> result = vec;
+template <typename T, std::size_t D>
+Vector<T, D> operator/(const Vector<T, D>& vec, T scalar) {
+    Vector<T, D> result = vec;
     result /= scalar;
     return result;
 }
 
-template <typename T>
-T dot(const Vector<T>& lhs, const Vector<T>& rhs) {
+template <typename T, std::size_t D>
+T dot(const Vector<T, D>& lhs, const Vector<T, D>& rhs) {
     T result{};
-    for (std::size_t i = 0; i < Vector<T>::dimensions; ++i) {
+    for (std::size_t i = 0; i < D; ++i) {
         result += lhs[i] * rhs[i];
     }
     return result;
@@ -142,10 +164,24 @@ Vector<T> cross(const Vector<T>& lhs, const Vector<T>& rhs) {
     );
 }
 
-template <typename T>
-std::ostream& operator<<(std::ostream& os, const Vector<T>& vec) {
-    os << "(" << vec.x() << ", " << vec.y() << ", " << vec.z() << ")";
+template <typename T, std::size_t D>
+std::ostream& operator<<(std::ostream& os, const Vector<T, D>& vec) {
+    os << "(" << vec.x();
+    for (std::size_t i = 1; i < D; ++i) {
+        os << ", " << vec[i];
+    }
+    os << ")";
     return os;
 }
 
+// Перевод вектора в размерность D: лишние компоненты отбрасываются, недостающие -- нулевые
+template <std::size_t D, typename T, std::size_t S>
+Vector<T, D> project(const Vector<T, S>& vec) {
+    Vector<T, D> result;
+    for (std::size_t i = 0; i < std::min(D, S); ++i) {
+        result[i] = vec[i];
+    }
+    return result;
+}
+
 } // namespace nbody 
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include "core/SimdPack.hpp"
+#include "core/Vector.hpp"
+
+
+
+namespace nbody {
+
+// Трёхмерный вектор в четырёх ячейках, выровненный на 32 байта: x, y, z и нулевое
+// дополнение. Для double операции выполняются одной пачкой DoublePack<4> (регистр AVX),
+// в остальных типах -- циклом по трём компонентам. add_scaled и fma_assign для double
+// используют FMA, где она есть, поэтому последний разряд может отличаться от Vector<T>
+template <typename T>
+class alignas(32) Vector4 {
+    static constexpr bool packed = std::is_same_v<T, double>;
+    using Pack = DoublePack<4>;
+
+public:
+    static constexpr std::size_t dimensions = 3;
+
+    Vector4() : data_{} {}
+
+    Vector4(T x, T y, T z) : data_{x, y, z, T{}} {}
+
+    Vector4(const Vector<T>& vec) : data_{vec[0], vec[1], vec[2], T{}} {}
+
+    operator Vector<T>() const {
+        return Vector<T>(data_[0], data_[1], data_[2]);
+    }
+
+    T& x() { return data_[0]; }
+    T& y() { return data_[1]; }
+    T& z() { return data_[2]; }
+
+    const T& x() const { return data_[0]; }
+    const T& y() const { return data_[1]; }
+    const T& z() const { return data_[2]; }
+
+    T& operator[](std::size_t index) { return data_[index]; }
+    const T& operator[](std::size_t index) const { return data_[index]; }
+
+    Vector4& operator+=(const Vector4& other) {
+        if constexpr (packed) {
+            (pack() + other.pack()).store(data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                data_[i] += other.data_[i];
+            }
+        }
+        return *this;
+    }
+
+    Vector4& operator-=(const Vector4& other) {
+        if constexpr (packed) {
+            (pack() - other.pack()).store(data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                data_[i] -= other.data_[i];
+            }
+        }
+        return *this;
+    }
+
+    Vector4& operator*=(T scalar) {
+        if constexpr (packed) {
+            (pack() * Pack::broadcast(scalar)).store(data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                data_[i] *= scalar;
+            }
+        }
+        return *this;
+    }
+
+    Vector4& operator/=(T scalar) {
+        if constexpr (packed) {
+            (pack() / Pack::broadcast(scalar)).store(data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                data_[i] /= scalar;
+            }
+        }
+        return *this;
+    }
+
+    // this += other * scalar
+    Vector4& add_scaled(const Vector4& other, T scalar) {
+        if constexpr (packed) {
+            Pack::multiply_add(other.pack(), Pack::broadcast(scalar), pack()).store(data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                data_[i] += other.data_[i] * scalar;
+            }
+        }
+        return *this;
+    }
+
+    // this = a + b * scalar
+    Vector4& fma_assign(const Vector4& a, const Vector4& b, T scalar) {
+        if constexpr (packed) {
+            Pack::multiply_add(b.pack(), Pack::broadcast(scalar), a.pack()).store(data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                data_[i] = a.data_[i] + b.data_[i] * scalar;
+            }
+        }
+        return *this;
+    }
+
+    T magnitude_squared() const {
+        return dot(*this, *this);
+    }
+
+    T magnitude() const {
+        return sqrt(magnitude_squared());
+    }
+
+    Vector4 operator-() const {
+        Vector4 result;
+        if constexpr (packed) {
+            (-pack()).store(result.data_.data());
+        } else {
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                result.data_[i] = -data_[i];
+            }
+        }
+        return result;
+    }
+
+    friend Vector4 operator+(Vector4 lhs, const Vector4& rhs) {
+        return lhs += rhs;
+    }
+
+    friend Vector4 operator-(Vector4 lhs, const Vector4& rhs) {
+        return lhs -= rhs;
+    }
+
+    friend Vector4 operator*(Vector4 vec, T scalar) {
+        return vec *= scalar;
+    }
+
+    friend Vector4 operator*(T scalar, Vector4 vec) {
+        return vec *= scalar;
+    }
+
+    friend Vector4 operator/(Vector4 vec, T scalar) {
+        return vec /= scalar;
+    }
+
+    friend T dot(const Vector4& lhs, const Vector4& rhs) {
+        if constexpr (packed) {
+            alignas(32) double products[4];
+            (lhs.pack() * rhs.pack()).store(products);
+            return (products[0] + products[1]) + products[2];
+        } else {
+            T result{};
+            for (std::size_t i = 0; i < dimensions; ++i) {
+                result += lhs.data_[i] * rhs.data_[i];
+            }
+            return result;
+        }
+    }
+
+private:
+    Pack pack() const requires packed {
+        return Pack::load(data_.data());
+    }
+
+    std::array<T, 4> data_;
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const Vector4<T>& vec) {
+    return os << Vector<T>(vec);
+}
+
+template <std::size_t D, typename T>
+Vector<T, D> project(const Vector4<T>& vec) {
+    return project<D>(Vector<T>(vec));
+}
+
+// Вектор для хранения состояния тел размерности D: Vector4 там, где он ложится
+// в регистр (double, D = 3), иначе Vector<T, D>
+template <typename T, std::size_t D = 3>
+using StorageVector = std::conditional_t<D == 3 && std::is_same_v<T, double>, Vector4<T>, Vector<T, D>>;
+
+} // namespace nbody
@@ -32,6 +32,12 @@ inline double two_diff(double a, double b, double &err)
 }
 
 
+// Аппаратное FMA вычисляет a*b - p одной операцией без промежуточного округления
+#if defined(__FMA__) || defined(__FP_FAST_FMA) || defined(__ARM_FEATURE_FMA)
+#define NBODY_HAS_FMA 1
+#endif
+
+
 inline void split(double a, double &hi, double &lo)
 {
     double temp;
@@ -43,11 +49,15 @@ inline void split(double a, double &hi, double &lo)
 
 inline double two_prod(double a, double b, double &err)
 {
-    double a_hi, a_lo, b_hi, b_lo;
     double p = a * b;
+#ifdef NBODY_HAS_FMA
+    err = std::fma(a, b, -p);
+#else
+    double a_hi, a_lo, b_hi, b_lo;
     split(a, a_hi, a_lo);
     split(b, b_hi, b_lo);
     err = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
     return p;
 }
 
@@ -62,10 +72,14 @@ inline double nint(double d)
 
 inline double two_square(double a, double &err)
 {
-    double hi, lo;
     double q = a * a;
+#ifdef NBODY_HAS_FMA
+    err = std::fma(a, a, -q);
+#else
+    double hi, lo;
     split(a, hi, lo);
     err = ((hi * hi - q) + 2.0 * hi * lo) + lo * lo;
+#endif
     return q;
 }
 
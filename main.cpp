@@ -8,8 +8,12 @@
 #include "core/Vector.hpp"
 #include "renderers/GtkmmRenderer.hpp"
 #include "renderers/RenderEngine.hpp"
+#include "simulators/FixedNewtonianSimulator.hpp"
+#include "simulators/HermiteSimulator.hpp"
+#include "simulators/IAS15Simulator.hpp"
 #include "simulators/NewtonianSimulator.hpp"
 #include "simulators/ParticleMeshSimulator.hpp"
+#include "simulators/WisdomHolmanSimulator.hpp"
 #include "systems/CircleSystem.hpp"
 #include "systems/SolarSystem.hpp"
 #include "systems/ThreeBodySystem.hpp"
@@ -71,9 +75,37 @@ private:
         
         Glib::OptionEntry simulator_entry;
         simulator_entry.set_long_name("simulator");
-        simulator_entry.set_description("Simulator type: newtonian or pm (particle-mesh)");
+        simulator_entry.set_description("Simulator type: newtonian, pm (particle-mesh), wh (wisdom-holman), ias15 or hermite");
         simulator_entry.set_arg_description("TYPE");
         
+        Glib::OptionEntry integrator_entry;
+        integrator_entry.set_long_name("integrator");
+        integrator_entry.set_description("Integrator for newtonian simulator: leapfrog, yoshida4, yoshida6, forest-ruth or pefrl");
+        integrator_entry.set_arg_description("SCHEME");
+        
+        Glib::OptionEntry adaptive_entry;
+        adaptive_entry.set_long_name("adaptive");
+        adaptive_entry.set_description("Adaptive timestep criterion: free-fall or jerk (--dt becomes the upper bound)");
+        adaptive_entry.set_arg_description("CRITERION");
+        
+        Glib::OptionEntry merge_entry;
+        merge_entry.set_long_name("merge-radius");
+        merge_entry.set_description("Merge colliding bodies after each step; RADIUS is the minimal body radius");
+        merge_entry.set_arg_description("RADIUS");
+        
+        Glib::OptionEntry regularize_entry;
+        regularize_entry.set_long_name("regularize");
+        regularize_entry.set_description("KS regularization of close pairs for newtonian simulator");
+        
+        Glib::OptionEntry compensated_entry;
+        compensated_entry.set_long_name("compensated");
+        compensated_entry.set_description("Kahan-compensated position and velocity updates for newtonian and pm simulators");
+        
+        Glib::OptionEntry energy_tree_entry;
+        energy_tree_entry.set_long_name("energy-tree");
+        energy_tree_entry.set_description("Estimate potential energy with a Barnes-Hut tree; ANGLE is the opening angle (accuracy)");
+        energy_tree_entry.set_arg_description("ANGLE");
+        
         Glib::OptionGroup* group = new Glib::OptionGroup("nbody", "N-Body Simulation Options");
         group->add_entry(dt_entry, cli_dt_value);
         group->add_entry(simulator_entry, [this](const Glib::ustring& option_name, const Glib::ustring& value, bool has_value) -> bool {
@@ -82,6 +114,22 @@ private:
             }
             return true;
         });
+        group->add_entry(integrator_entry, [this](const Glib::ustring& option_name, const Glib::ustring& value, bool has_value) -> bool {
+            if (has_value) {
+                integrator_type = std::string(value);
+            }
+            return true;
+        });
+        group->add_entry(adaptive_entry, [this](const Glib::ustring& option_name, const Glib::ustring& value, bool has_value) -> bool {
+            if (has_value) {
+                adaptive_criterion = std::string(value);
+            }
+            return true;
+        });
+        group->add_entry(merge_entry, merge_radius);
+        group->add_entry(regularize_entry, regularize);
+        group->add_entry(compensated_entry, compensated);
+        group->add_entry(energy_tree_entry, energy_opening_angle);
         
         app->add_option_group(*group);
     }
@@ -98,8 +146,14 @@ private:
                 grid_size = 64;
             }
             simulator = std::make_unique<nbody::ParticleMeshSimulator<double>>(grid_size);
+        } else if (simulator_type == "wh" || simulator_type == "wisdom-holman") {
+            simulator = std::make_unique<nbody::WisdomHolmanSimulator<double>>();
+        } else if (simulator_type == "ias15") {
+            simulator = std::make_unique<nbody::IAS15Simulator<double>>();
+        } else if (simulator_type == "hermite") {
+            simulator = std::make_unique<nbody::HermiteSimulator<double>>();
         } else {
-            simulator = std::make_unique<nbody::NewtonianSimulator<double>>();
+            simulator = make_newtonian_simulator();
         }
         simulator->set_system(&system);
 
@@ -112,6 +166,19 @@ private:
         std::cout << "INFO: G value: " << g_value << std::endl;
         simulator->set_g(g_value);
         simulator->set_dt(cli_dt_value);
+        if (adaptive_criterion == "free-fall") {
+            simulator->set_time_step_criterion(nbody::TimeStepCriterion::FreeFall);
+        } else if (adaptive_criterion == "jerk") {
+            simulator->set_time_step_criterion(nbody::TimeStepCriterion::AccelerationJerk);
+        }
+        if (merge_radius > 0.0) {
+            simulator->collision_merger().set_minimum_radius(merge_radius);
+            simulator->set_collisions(true);
+        }
+        simulator->set_compensated(compensated);
+        if (energy_opening_angle > 0.0) {
+            system.set_potential_method(nbody::PotentialMethod::Tree, energy_opening_angle);
+        }
 
         if (!renderer.initialize(simulator.get())) {
             std::cerr << "ERROR: Не удалось инициализировать рендерер" << std::endl;
@@ -183,6 +250,33 @@ private:
         }, 100);
     }
     
+    std::unique_ptr<nbody::Simulator<double>> make_newtonian_simulator() const {
+        std::cout << "INFO: Схема интегрирования: " << integrator_type << std::endl;
+        if (integrator_type == "yoshida4") {
+            return make_newtonian<nbody::Yoshida4>();
+        } else if (integrator_type == "yoshida6") {
+            return make_newtonian<nbody::Yoshida6>();
+        } else if (integrator_type == "forest-ruth") {
+            return make_newtonian<nbody::ForestRuth>();
+        } else if (integrator_type == "pefrl") {
+            return make_newtonian<nbody::PEFRL>();
+        }
+        return make_newtonian<nbody::Leapfrog>();
+    }
+
+    template <typename Scheme>
+    std::unique_ptr<nbody::Simulator<double>> make_newtonian() const {
+        // Регуляризация, слияние тел и компенсированное суммирование поддерживаются только
+        // симулятором с произвольным числом тел
+        if (!regularize && merge_radius <= 0.0 && !compensated) {
+            return nbody::make_newtonian_simulator<double, Scheme>(system);
+        }
+        constexpr std::size_t dimensions = nbody::system_dimensions<decltype(system)>();
+        auto result = std::make_unique<nbody::NewtonianSimulator<double, Scheme, dimensions>>();
+        result->set_regularization(regularize);
+        return result;
+    }
+    
     void on_shutdown() {
         std::cout << "INFO: Приложение завершается, останавливаем симуляцию..." << std::endl;
         running = false;
@@ -197,17 +291,31 @@ private:
     
     void simulation_loop() {
         const int steps_per_frame = simulator->steps_per_frame();
+        // Система проверяется ниже раз в кадр, run_steps её не проверяет
+        const std::size_t validation_interval = simulator->validation_interval();
+        simulator->set_validation_interval(0);
         
         while (running) {
             auto frame_start = std::chrono::steady_clock::now();
             
             if (!renderer.is_paused()) {
-                for (int i = 0; i < steps_per_frame && running; ++i) {
-                    if (!simulator->step()) {
-                        std::cerr << "ERROR: Ошибка в шаге симуляции" << std::endl;
-                        running = false;
-                        break;
+                if (simulator->adaptive()) {
+                    // За кадр проходит то же время, что и при постоянном шаге; последний шаг обрезается
+                    const double frame_time = simulator->dt() * steps_per_frame;
+                    double elapsed = 0.0;
+                    while (frame_time - elapsed > frame_time * 1e-12 && running) {
+                        simulator->set_dt_limit(frame_time - elapsed);
+                        if (!simulator->step()) {
+                            std::cerr << "ERROR: Ошибка в шаге симуляции" << std::endl;
+                            running = false;
+                            break;
+                        }
+                        elapsed += simulator->last_dt();
                     }
+                    simulator->set_dt_limit(0.0);
+                } else if (simulator->run_steps(steps_per_frame) < std::size_t(steps_per_frame)) {
+                    std::cerr << "ERROR: Ошибка в шаге симуляции" << std::endl;
+                    running = false;
                 }
                 renderer.render(system);
             } else {
@@ -236,6 +344,7 @@ private:
             if (!renderer.is_paused()) std::cout << "INFO: Время рендера шага: " << std::chrono::duration_cast<std::chrono::milliseconds>(render_time).count() << " мс" << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(17) - render_time);
         }
+        simulator->set_validation_interval(validation_interval);
     }
     
     void cleanup() {
@@ -302,6 +411,12 @@ private:
     std::unique_ptr<nbody::Simulator<double>> simulator;
     nbody::GtkmmRenderer<double> renderer;
     std::string simulator_type;
+    std::string integrator_type = "leapfrog";
+    std::string adaptive_criterion;
+    bool regularize = false;
+    bool compensated = false;
+    double merge_radius = 0.0;
+    double energy_opening_angle = 0.0;
     std::unique_ptr<Gtk::Box> grid_viz_box;
 };
 
@@ -350,6 +350,10 @@ public:
     
     bool initialize(Simulator<T>* simulator) override {
         this->simulator_ = simulator;
+        // График энергии строится каждый кадр: потенциальная часть берётся из вычисления сил
+        if (simulator) {
+            simulator->set_energy_tracking(true);
+        }
         
         m_drawing_area = std::make_unique<NBodyDrawingArea<T>>();
         m_drawing_area->set_size_request(1024, 700);
@@ -518,20 +522,20 @@ public:
         }
         
         // Обновляем данные плотности
-        auto density_data = pm_sim->get_density_grid();
+        const auto& density_data = pm_sim->get_density_grid();
         std::vector<double> density_double(density_data.begin(), density_data.end());
         m_grid_visualization_widget->set_density_data(density_double, grid_size);
         
         // Обновляем данные потенциала
-        auto potential_data = pm_sim->get_potential_grid();
+        const auto& potential_data = pm_sim->get_potential_grid();
         std::vector<double> potential_double(potential_data.begin(), potential_data.end());
         m_grid_visualization_widget->set_potential_data(potential_double, grid_size);
         
         // Обновляем FFT данные
-        auto fft_in_data = pm_sim->get_fft_in_data();
+        const auto& fft_in_data = pm_sim->get_fft_in_data();
         m_grid_visualization_widget->set_fft_in_data(fft_in_data, grid_size);
         
-        auto fft_out_data = pm_sim->get_fft_out_data();
+        const auto& fft_out_data = pm_sim->get_fft_out_data();
         m_grid_visualization_widget->set_fft_out_data(fft_out_data, grid_size);
     }
     
@@ -124,24 +124,46 @@ bool RenderEngine<T>::execute(SystemType& system, SimulatorType& simulator, Rend
     }
 
     simulator.set_dt(settings_.dt);
+    if (settings_.save_energy) {
+        simulator.set_energy_tracking(true);
+    }
     auto start_time = std::chrono::steady_clock::now();
 
     const int video_fps = 60;
     const double time_per_frame = 1.0 / video_fps;
     const int steps_per_frame = std::max(1, static_cast<int>(time_per_frame / settings_.dt));
     
+    if (simulator.adaptive()) {
+        std::cout << "Адаптивный шаг: dt -- верхняя граница шага" << std::endl;
+    }
     std::cout << "Шагов симуляции на кадр: " << steps_per_frame << std::endl;
     std::cout << "Всего шагов симуляции: " << total_frames_ * steps_per_frame << std::endl;
     
+    // В адаптивном режиме шаг переменный, поэтому последний шаг кадра обрезается,
+    // чтобы кадры приходились ровно на моменты steps_per_frame * dt
+    const T frame_time = T(settings_.dt) * T(double(steps_per_frame));
+    
     for (int frame = 0; frame < total_frames_; ++frame) {
-        for (int step = 0; step < steps_per_frame; ++step) {
-            if (!simulator.step()) {
-                std::cerr << "ERROR: Ошибка в шаге симуляции на кадре " << frame << ", шаге " << step << std::endl;
+        if (simulator.adaptive()) {
+            const T frame_end = simulator.current_time() + frame_time;
+            const std::size_t done = simulator.advance_to(frame_end);
+            if (simulator.validation_failed()) {
+                std::cerr << "ERROR: Система стала некорректной на кадре " << frame << ", шаге " << done << std::endl;
                 return false;
             }
-
-            if (!system.is_valid()) {
-                std::cerr << "ERROR: Система стала некорректной на кадре " << frame << ", шаге " << step << std::endl;
+            if (frame_end - simulator.current_time() > frame_time * T{1e-9}) {
+                std::cerr << "ERROR: Ошибка в шаге симуляции на кадре " << frame << ", шаге " << done << std::endl;
+                return false;
+            }
+        } else {
+            // Шаги кадра одним пакетом: симулятор может слить соседние шаги
+            const std::size_t done = simulator.run_steps(std::size_t(steps_per_frame));
+            if (simulator.validation_failed()) {
+                std::cerr << "ERROR: Система стала некорректной на кадре " << frame << ", шаге " << done << std::endl;
+                return false;
+            }
+            if (done < std::size_t(steps_per_frame)) {
+                std::cerr << "ERROR: Ошибка в шаге симуляции на кадре " << frame << ", шаге " << done << std::endl;
                 return false;
             }
         }
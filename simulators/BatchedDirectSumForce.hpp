@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/DoubleDouble.h"
+#include "core/DoubleDoubleN.hpp"
+#include "core/Vector.hpp"
+
+
+
+namespace nbody {
+
+// Прямое суммирование ускорений в DoubleDouble, векторизованное по телам-источникам:
+// ускорение тела i набирается пачками по Batch::width тел j в DoubleDoubleN, остаток
+// строки досчитывается скалярно. Каждая пара считается дважды (для i и для j), зато
+// без разбросанной записи, поэтому при ширине 4-8 выигрыш в 2-4 раза над DirectSumForce
+template <typename Batch = DoubleDoubleN<>>
+class BatchedDirectSumForce {
+public:
+    using T = DoubleDouble;
+    using Pack = typename Batch::Pack;
+
+    static constexpr std::size_t width = Batch::width;
+    static constexpr std::size_t no_pair = std::numeric_limits<std::size_t>::max();
+
+    BatchedDirectSumForce() = default;
+
+    void set_g(T g) {
+        g_ = g;
+    }
+
+    void exclude_pair(std::size_t i, std::size_t j) {
+        excluded_i_ = std::min(i, j);
+        excluded_j_ = std::max(i, j);
+    }
+
+    void include_all_pairs() {
+        excluded_i_ = no_pair;
+        excluded_j_ = no_pair;
+    }
+
+    void set_track_potential(bool enabled) {
+        track_potential_ = enabled;
+    }
+
+    // Сумма m_i * m_j / r_ij по парам за последний compute (при set_track_potential)
+    T potential_sum() const {
+        return potential_sum_;
+    }
+
+    void compute(const std::vector<Body<T>>& bodies, std::vector<Vector<T>>& accelerations) {
+        load<3>(bodies.size(), [&](std::size_t i) -> const Vector<T>& { return bodies[i].position(); },
+                [&](std::size_t i) { return bodies[i].mass(); });
+        sum(accelerations);
+    }
+
+    template <std::size_t D>
+    void compute(const std::vector<Vector<T, D>>& positions, const std::vector<T>& masses,
+                 std::vector<Vector<T, D>>& accelerations) {
+        load<D>(positions.size(), [&](std::size_t i) -> const Vector<T, D>& { return positions[i]; },
+                [&](std::size_t i) { return masses[i]; });
+        sum(accelerations);
+    }
+
+private:
+    // Раскладка координат и масс по массивам старших и младших частей
+    template <std::size_t D, typename PositionOf, typename MassOf>
+    void load(std::size_t n, PositionOf position_of, MassOf mass_of) {
+        n_ = n;
+        for (std::size_t d = 0; d < D; ++d) {
+            hi_[d].resize(n);
+            lo_[d].resize(n);
+        }
+        mass_hi_.resize(n);
+        mass_lo_.resize(n);
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const Vector<T, D>& position = position_of(i);
+            for (std::size_t d = 0; d < D; ++d) {
+                hi_[d][i] = position[d].hi;
+                lo_[d][i] = position[d].lo;
+            }
+            const T mass = mass_of(i);
+            mass_hi_[i] = mass.hi;
+            mass_lo_[i] = mass.lo;
+        }
+    }
+
+    template <std::size_t D>
+    void sum(std::vector<Vector<T, D>>& accelerations) {
+        accelerations.assign(n_, Vector<T, D>{});
+        potential_sum_ = T{0};
+        for (std::size_t i = 0; i < n_; ++i) {
+            // Исключённая пара убирается из строки обнулением массы партнёра
+            const std::size_t partner = i == excluded_i_ ? excluded_j_ : (i == excluded_j_ ? excluded_i_ : no_pair);
+            if (partner < n_) {
+                std::swap(mass_hi_[partner], hidden_mass_hi_);
+                std::swap(mass_lo_[partner], hidden_mass_lo_);
+            }
+
+            T row_potential;
+            accelerations[i] = (track_potential_ ? row<D, true>(i, row_potential)
+                                                 : row<D, false>(i, row_potential)) * g_;
+            // Каждая пара входит в строки обоих тел, отсюда половина в конце
+            if (track_potential_) {
+                potential_sum_ += T(mass_hi_[i], mass_lo_[i]) * row_potential;
+            }
+
+            if (partner < n_) {
+                std::swap(mass_hi_[partner], hidden_mass_hi_);
+                std::swap(mass_lo_[partner], hidden_mass_lo_);
+            }
+        }
+        potential_sum_ *= T{0.5};
+    }
+
+    // Ускорение тела i без множителя G; при Potential в potential -- сумма m_j / r_ij по строке
+    template <std::size_t D, bool Potential>
+    Vector<T, D> row(std::size_t i, T& potential) const {
+        const std::size_t full = n_ - n_ % width;
+
+        std::array<Batch, D> position_i;
+        for (std::size_t d = 0; d < D; ++d) {
+            position_i[d] = Batch(T(hi_[d][i], lo_[d][i]));
+        }
+
+        std::array<Batch, D> acceleration{};
+        Batch row_potential;
+        Pack near = Pack::broadcast(0.0);
+        const Pack one = Pack::broadcast(1.0);
+        for (std::size_t j = 0; j < full; j += width) {
+            std::array<Batch, D> r;
+            for (std::size_t d = 0; d < D; ++d) {
+                r[d] = Batch::load(&hi_[d][j], &lo_[d][j]) - position_i[d];
+            }
+            Batch distance_squared = r[0] * r[0];
+            for (std::size_t d = 1; d < D; ++d) {
+                distance_squared += r[d] * r[d];
+            }
+
+            // Совпадающие тела (и само тело i) дают нулевой вклад; расстояние подменяется
+            // ненулевым, чтобы корень и деление не порождали NaN
+            const Pack singular = Pack::less(distance_squared.hi, 1e-20);
+            near = near + singular;
+            distance_squared = distance_squared + singular;
+            const Batch mass = Batch::load(&mass_hi_[j], &mass_lo_[j]) * (one - singular);
+
+            const Batch scale = mass / (distance_squared * sqrt(distance_squared));
+            for (std::size_t d = 0; d < D; ++d) {
+                acceleration[d] += r[d] * scale;
+            }
+            if constexpr (Potential) {
+                row_potential += scale * distance_squared;
+            }
+        }
+
+        Vector<T, D> result;
+        for (std::size_t d = 0; d < D; ++d) {
+            result[d] = acceleration[d].sum();
+        }
+        potential = Potential ? row_potential.sum() : T{0};
+
+        // Кроме самого тела i в пачках нашлись совпадающие с ним тела
+        const double expected = i < full ? 1.0 : 0.0;
+        if (full > 0 && Batch(near, Pack::broadcast(0.0)).sum().hi > expected) {
+            for (std::size_t j = 0; j < full; ++j) {
+                if (j != i && (position<D>(j) - position<D>(i)).magnitude_squared() < T{1e-20}) {
+                    warn_singular(i, j);
+                    break;
+                }
+            }
+        }
+
+        for (std::size_t j = full; j < n_; ++j) {
+            if (j == i) {
+                continue;
+            }
+            const Vector<T, D> r = position<D>(j) - position<D>(i);
+            const T distance_squared = r.magnitude_squared();
+            if (distance_squared < T{1e-20}) {
+                warn_singular(i, j);
+                continue;
+            }
+            const T scale = T(mass_hi_[j], mass_lo_[j]) / (distance_squared * sqrt(distance_squared));
+            result.add_scaled(r, scale);
+            if constexpr (Potential) {
+                potential += scale * distance_squared;
+            }
+        }
+        return result;
+    }
+
+    template <std::size_t D>
+    Vector<T, D> position(std::size_t i) const {
+        Vector<T, D> result;
+        for (std::size_t d = 0; d < D; ++d) {
+            result[d] = T(hi_[d][i], lo_[d][i]);
+        }
+        return result;
+    }
+
+    void warn_singular(std::size_t i, std::size_t j) const {
+        if (!singular_warned_) {
+            std::cerr << "BatchedDirectSumForce -- WARNING: тела " << i << " и " << j
+                      << " совпадают, сила между ними не учитывается" << std::endl;
+            singular_warned_ = true;
+        }
+    }
+
+    T g_ = T{1};
+    mutable bool singular_warned_ = false;
+    std::size_t excluded_i_ = no_pair;
+    std::size_t excluded_j_ = no_pair;
+    bool track_potential_ = false;
+    T potential_sum_ = T{0};
+
+    std::size_t n_ = 0;
+    std::array<std::vector<double>, 3> hi_;
+    std::array<std::vector<double>, 3> lo_;
+    std::vector<double> mass_hi_;
+    std::vector<double> mass_lo_;
+    double hidden_mass_hi_ = 0.0;
+    double hidden_mass_lo_ = 0.0;
+};
+
+} // namespace nbody
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/Vector.hpp"
+
+
+
+namespace nbody {
+
+// Поиск столкновений через равномерную хеш-сетку и слияние столкнувшихся тел.
+// Сторона ячейки -- наибольший диаметр, поэтому пары на расстоянии не больше суммы
+// радиусов лежат в соседних ячейках и поиск занимает O(N). Слияние сохраняет массу,
+// импульс и объём; группы из нескольких тел сливаются целиком
+template <typename T>
+class CollisionMerger {
+public:
+    CollisionMerger() = default;
+
+    // Тела с меньшим радиусом (в том числе точечные) считаются шарами этого радиуса
+    void set_minimum_radius(T radius) {
+        if (radius < T{0}) {
+            throw std::invalid_argument("Minimal radius must be non-negative");
+        }
+        minimum_radius_ = radius;
+    }
+
+    T minimum_radius() const {
+        return minimum_radius_;
+    }
+
+    // Суммарное число тел, поглощённых при слияниях
+    std::size_t merged_count() const {
+        return merged_count_;
+    }
+
+    // Слияние столкнувшихся тел и уплотнение bodies на месте; возвращает число удалённых тел.
+    // Слитое тело занимает место члена группы с наименьшим индексом и носит имя самого массивного
+    std::size_t merge(std::vector<Body<T>>& bodies) {
+        const std::size_t n = bodies.size();
+        if (n < 2) {
+            return 0;
+        }
+
+        T max_radius = T{0};
+        for (const auto& body : bodies) {
+            max_radius = std::max(max_radius, effective_radius(body));
+        }
+        if (!(max_radius > T{0})) {
+            return 0;
+        }
+
+        build_grid(bodies, double(max_radius) * 2.0);
+        if (!find_collisions(bodies)) {
+            return 0;
+        }
+
+        const std::size_t removed = combine(bodies);
+        merged_count_ += removed;
+        return removed;
+    }
+
+private:
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    struct Cell {
+        std::int64_t x;
+        std::int64_t y;
+        std::int64_t z;
+
+        bool operator==(const Cell& other) const {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    T effective_radius(const Body<T>& body) const {
+        return std::max(body.radius(), minimum_radius_);
+    }
+
+    static std::int64_t cell_index(double coordinate, double cell_size) {
+        // Нечисловые и слишком далёкие координаты сводятся в одну граничную ячейку
+        const double q = coordinate / cell_size;
+        if (!(std::abs(q) < 1e15)) {
+            return std::int64_t{1000000000000000};
+        }
+        return static_cast<std::int64_t>(std::floor(q));
+    }
+
+    std::size_t bucket(const Cell& cell) const {
+        const std::uint64_t h = std::uint64_t(cell.x) * 73856093u
+            ^ std::uint64_t(cell.y) * 19349663u
+            ^ std::uint64_t(cell.z) * 83492791u;
+        return std::size_t(h) & (heads_.size() - 1);
+    }
+
+    // Тела раскладываются по цепочкам в хеш-таблице размера степени двойки не меньше 2N
+    void build_grid(const std::vector<Body<T>>& bodies, double cell_size) {
+        const std::size_t n = bodies.size();
+        std::size_t table_size = 1;
+        while (table_size < 2 * n) {
+            table_size *= 2;
+        }
+
+        heads_.assign(table_size, none);
+        next_.resize(n);
+        cells_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const Vector<T>& position = bodies[i].position();
+            cells_[i] = Cell{cell_index(double(position.x()), cell_size),
+                             cell_index(double(position.y()), cell_size),
+                             cell_index(double(position.z()), cell_size)};
+            const std::size_t b = bucket(cells_[i]);
+            next_[i] = heads_[b];
+            heads_[b] = i;
+        }
+    }
+
+    // Пары на расстоянии не больше суммы радиусов объединяются в группы (система непересекающихся множеств)
+    bool find_collisions(const std::vector<Body<T>>& bodies) {
+        const std::size_t n = bodies.size();
+        parent_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            parent_[i] = i;
+        }
+
+        bool found = false;
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::int64_t dx = -1; dx <= 1; ++dx) {
+                for (std::int64_t dy = -1; dy <= 1; ++dy) {
+                    for (std::int64_t dz = -1; dz <= 1; ++dz) {
+                        const Cell cell{cells_[i].x + dx, cells_[i].y + dy, cells_[i].z + dz};
+                        for (std::size_t j = heads_[bucket(cell)]; j != none; j = next_[j]) {
+                            // Разные ячейки могут попасть в одну цепочку -- проверяем саму ячейку
+                            if (j <= i || !(cells_[j] == cell)) {
+                                continue;
+                            }
+                            const T reach = effective_radius(bodies[i]) + effective_radius(bodies[j]);
+                            const T distance_squared = (bodies[j].position() - bodies[i].position()).magnitude_squared();
+                            if (distance_squared <= reach * reach) {
+                                unite(i, j);
+                                found = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    std::size_t find(std::size_t i) {
+        while (parent_[i] != i) {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
+    }
+
+    // Корень группы -- член с наименьшим индексом
+    void unite(std::size_t i, std::size_t j) {
+        const std::size_t a = find(i);
+        const std::size_t b = find(j);
+        if (a != b) {
+            parent_[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    std::size_t combine(std::vector<Body<T>>& bodies) {
+        const std::size_t n = bodies.size();
+        mass_.assign(n, T{0});
+        volume_.assign(n, T{0});
+        count_.assign(n, 0);
+        heaviest_.resize(n);
+        moment_.assign(n, Vector<T>{});
+        momentum_.assign(n, Vector<T>{});
+        position_sum_.assign(n, Vector<T>{});
+        velocity_sum_.assign(n, Vector<T>{});
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t root = find(i);
+            const Body<T>& body = bodies[i];
+            if (count_[root] == 0 || body.mass() > bodies[heaviest_[root]].mass()) {
+                heaviest_[root] = i;
+            }
+            ++count_[root];
+            mass_[root] += body.mass();
+            // Объём по тому же радиусу, что и при поиске столкновений: иначе точечные тела
+            // сливаются в точечное и слитое тело не растёт
+            const T radius = effective_radius(body);
+            volume_[root] += radius * radius * radius;
+            moment_[root].add_scaled(body.position(), body.mass());
+            momentum_[root].add_scaled(body.velocity(), body.mass());
+            position_sum_[root] += body.position();
+            velocity_sum_[root] += body.velocity();
+        }
+
+        std::size_t write = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (parent_[i] != i) {
+                continue;
+            }
+
+            if (count_[i] > 1) {
+                Body<T>& body = bodies[i];
+                if (heaviest_[i] != i) {
+                    body.set_name_id(bodies[heaviest_[i]].name_id());
+                }
+                // Группа пробных частиц нулевой массы сливается в геометрический центр
+                if (mass_[i] > T{0}) {
+                    body.set_position(moment_[i] / mass_[i]);
+                    body.set_velocity(momentum_[i] / mass_[i]);
+                } else {
+                    const T count{double(count_[i])};
+                    body.set_position(position_sum_[i] / count);
+                    body.set_velocity(velocity_sum_[i] / count);
+                }
+                body.set_mass(mass_[i]);
+                body.set_radius(T{std::cbrt(double(volume_[i]))});
+            }
+
+            if (write != i) {
+                bodies[write] = std::move(bodies[i]);
+            }
+            ++write;
+        }
+
+        const std::size_t removed = n - write;
+        bodies.resize(write);
+        return removed;
+    }
+
+    T minimum_radius_ = T{0};
+    std::size_t merged_count_ = 0;
+
+    std::vector<std::size_t> heads_;
+    std::vector<std::size_t> next_;
+    std::vector<Cell> cells_;
+    std::vector<std::size_t> parent_;
+
+    std::vector<T> mass_;
+    std::vector<T> volume_;
+    std::vector<std::size_t> count_;
+    std::vector<std::size_t> heaviest_;
+    std::vector<Vector<T>> moment_;
+    std::vector<Vector<T>> momentum_;
+    std::vector<Vector<T>> position_sum_;
+    std::vector<Vector<T>> velocity_sum_;
+};
+
+} // namespace nbody
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/DoubleDouble.h"
+#include "core/Vector.hpp"
+#include "simulators/BatchedDirectSumForce.hpp"
+#include "simulators/MixedPrecisionForce.hpp"
+
+
+
+namespace nbody {
+
+// Прямое попарное суммирование гравитационных ускорений, O(N^2)
+// Ускорение считается сразу как G*m_j*r/|r|^3, без деления силы на массу,
+// поэтому тела нулевой массы (пробные частицы) обрабатываются корректно.
+// В DoubleDouble при числе тел от batched_threshold суммирование передаётся
+// векторизованному ядру BatchedDirectSumForce, при политиках MixedPrecision и
+// SinglePrecision -- ядру MixedPrecisionForce с силами пар в double или float
+template <typename T, typename Precision = FullPrecision>
+class DirectSumForce {
+public:
+    static constexpr std::size_t no_pair = std::numeric_limits<std::size_t>::max();
+    static constexpr std::size_t batched_threshold = 8;
+    static constexpr bool tracks_potential = !std::is_same_v<Precision, SinglePrecision>;
+
+    DirectSumForce() = default;
+
+    void set_g(T g) {
+        g_ = g;
+        if constexpr (has_kernel) {
+            kernel_.set_g(g);
+        }
+    }
+
+    T g() const {
+        return g_;
+    }
+
+    // Исключение одной пары из суммы (например, пары, уже учтённой аналитически)
+    void exclude_pair(std::size_t i, std::size_t j) {
+        excluded_i_ = std::min(i, j);
+        excluded_j_ = std::max(i, j);
+        if constexpr (has_kernel) {
+            kernel_.exclude_pair(i, j);
+        }
+    }
+
+    void include_all_pairs() {
+        excluded_i_ = no_pair;
+        excluded_j_ = no_pair;
+        if constexpr (has_kernel) {
+            kernel_.include_all_pairs();
+        }
+    }
+
+    // Попутный подсчёт суммы m_i * m_j / r_ij по учтённым парам (см. potential_sum).
+    // При SinglePrecision сумма во float была бы точнее пересчёта лишь до 1e-8, поэтому
+    // не поддерживается
+    void set_track_potential(bool enabled) {
+        track_potential_ = enabled && tracks_potential;
+        if constexpr (has_kernel) {
+            kernel_.set_track_potential(track_potential_);
+        }
+    }
+
+    // Сумма m_i * m_j / r_ij за последний вызов compute при включённом set_track_potential
+    T potential_sum() const {
+        if constexpr (has_kernel) {
+            if (kernel_used_) {
+                return T{kernel_.potential_sum()};
+            }
+        }
+        return potential_sum_;
+    }
+
+    void compute(const std::vector<Body<T>>& bodies, std::vector<Vector<T>>& accelerations) const {
+        const std::size_t n = bodies.size();
+        if constexpr (has_kernel) {
+            kernel_used_ = mixed || n >= batched_threshold;
+            if (kernel_used_) {
+                kernel_.compute(bodies, accelerations);
+                return;
+            }
+        }
+
+        accelerations.assign(n, Vector<T>{});
+        potential_sum_ = T{0};
+
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = i + 1; j < n; ++j) {
+                add_pair(i, j, bodies[i].position(), bodies[j].position(),
+                         bodies[i].mass(), bodies[j].mass(), accelerations);
+            }
+        }
+    }
+
+    // Вариант для массивов положений произвольной размерности (в том числе плоских, D = 2)
+    template <std::size_t D>
+    void compute(const std::vector<Vector<T, D>>& positions, const std::vector<T>& masses,
+                 std::vector<Vector<T, D>>& accelerations) const {
+        const std::size_t n = positions.size();
+        if constexpr (has_kernel) {
+            kernel_used_ = mixed || n >= batched_threshold;
+            if (kernel_used_) {
+                kernel_.compute(positions, masses, accelerations);
+                return;
+            }
+        }
+
+        accelerations.assign(n, Vector<T, D>{});
+        potential_sum_ = T{0};
+
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = i + 1; j < n; ++j) {
+                add_pair(i, j, positions[i], positions[j], masses[i], masses[j], accelerations);
+            }
+        }
+    }
+
+    // Ускорения и их производные (jerk) только для тел из active -- от всех остальных тел.
+    // Результат пишется по индексам тел, остальные элементы не трогаются
+    void compute_with_jerk(const std::vector<std::size_t>& active,
+                           const std::vector<Vector<T>>& positions, const std::vector<Vector<T>>& velocities,
+                           const std::vector<T>& masses,
+                           std::vector<Vector<T>>& accelerations, std::vector<Vector<T>>& jerks) const {
+        const std::size_t n = positions.size();
+        accelerations.resize(n);
+        jerks.resize(n);
+
+        for (std::size_t i : active) {
+            Vector<T> acceleration{};
+            Vector<T> jerk{};
+            for (std::size_t j = 0; j < n; ++j) {
+                if (j == i || (std::min(i, j) == excluded_i_ && std::max(i, j) == excluded_j_)) {
+                    continue;
+                }
+
+                Vector<T> r = positions[j] - positions[i];
+                Vector<T> v = velocities[j] - velocities[i];
+                T distance_squared = r.magnitude_squared();
+                if (distance_squared < T{1e-20}) {
+                    warn_singular(i, j);
+                    continue;
+                }
+
+                // a = G*m*r/r^3, j = G*m*(v/r^3 - 3*(r.v)*r/r^5)
+                T inv_r3 = T{1} / (distance_squared * sqrt(distance_squared));
+                T scale = g_ * masses[j] * inv_r3;
+                T rv = T{3} * dot(r, v) / distance_squared;
+                acceleration.add_scaled(r, scale);
+                jerk.add_scaled(v - r * rv, scale);
+            }
+            accelerations[i] = acceleration;
+            jerks[i] = jerk;
+        }
+    }
+
+    // Наименьшее по парам характерное время сближения: время свободного падения
+    // sqrt(r^3 / G(m_i + m_j)) или время пролёта r / |v_ij|
+    T min_free_fall_time(const std::vector<Body<T>>& bodies) const {
+        T result = std::numeric_limits<double>::max();
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                const T distance_squared = (bodies[j].position() - bodies[i].position()).magnitude_squared();
+                if (distance_squared < T{1e-20}) {
+                    continue;
+                }
+
+                const T mass = g_ * (bodies[i].mass() + bodies[j].mass());
+                if (mass > T{0}) {
+                    result = std::min(result, T{sqrt(distance_squared * sqrt(distance_squared) / mass)});
+                }
+                const T speed_squared = (bodies[j].velocity() - bodies[i].velocity()).magnitude_squared();
+                if (speed_squared > T{0}) {
+                    result = std::min(result, T{sqrt(distance_squared / speed_squared)});
+                }
+            }
+        }
+        return result;
+    }
+
+    // Наименьшее по телам отношение |a| / |da/dt|; тела в точке равновесия (a = 0) не учитываются
+    T min_acceleration_jerk_time(const std::vector<Body<T>>& bodies) {
+        const std::size_t n = bodies.size();
+        positions_.resize(n);
+        velocities_.resize(n);
+        masses_.resize(n);
+        all_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            positions_[i] = bodies[i].position();
+            velocities_[i] = bodies[i].velocity();
+            masses_[i] = bodies[i].mass();
+            all_[i] = i;
+        }
+        compute_with_jerk(all_, positions_, velocities_, masses_, accelerations_, jerks_);
+
+        T result = std::numeric_limits<double>::max();
+        for (std::size_t i = 0; i < n; ++i) {
+            const T acceleration = accelerations_[i].magnitude();
+            const T jerk = jerks_[i].magnitude();
+            if (acceleration > T{0} && jerk > T{0}) {
+                result = std::min(result, T{acceleration / jerk});
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr bool single = std::is_same_v<Precision, SinglePrecision>;
+    static constexpr bool mixed = single || std::is_same_v<Precision, MixedPrecision>;
+    static constexpr bool has_kernel = mixed || std::is_same_v<T, DoubleDouble>;
+    struct NoKernel {};
+    using Kernel = std::conditional_t<mixed, MixedPrecisionForce<T, std::conditional_t<single, float, double>>,
+                                      std::conditional_t<has_kernel, BatchedDirectSumForce<>, NoKernel>>;
+
+    template <std::size_t D>
+    void add_pair(std::size_t i, std::size_t j, const Vector<T, D>& position_i, const Vector<T, D>& position_j,
+                  T mass_i, T mass_j, std::vector<Vector<T, D>>& accelerations) const {
+        if (i == excluded_i_ && j == excluded_j_) {
+            return;
+        }
+
+        Vector<T, D> r = position_j - position_i;
+        T distance_squared = r.magnitude_squared();
+
+        // Совпадающие тела: сила не определена, пара пропускается с предупреждением
+        if (distance_squared < T{1e-20}) {
+            warn_singular(i, j);
+            return;
+        }
+
+        const T distance = sqrt(distance_squared);
+        Vector<T, D> scaled = r * (g_ / (distance_squared * distance));
+        accelerations[i].add_scaled(scaled, mass_j);
+        accelerations[j].add_scaled(scaled, -mass_i);
+        if (track_potential_) {
+            potential_sum_ += mass_i * mass_j / distance;
+        }
+    }
+
+    void warn_singular(std::size_t i, std::size_t j) const {
+        if (!singular_warned_) {
+            std::cerr << "DirectSumForce -- WARNING: тела " << i << " и " << j
+                      << " совпадают, сила между ними не учитывается" << std::endl;
+            singular_warned_ = true;
+        }
+    }
+
+    T g_ = T{1};
+    mutable bool singular_warned_ = false;
+    std::size_t excluded_i_ = no_pair;
+    std::size_t excluded_j_ = no_pair;
+    bool track_potential_ = false;
+    mutable T potential_sum_ = T{0};
+    mutable bool kernel_used_ = false;
+    mutable Kernel kernel_;
+
+    // Рабочие буферы для min_acceleration_jerk_time
+    std::vector<std::size_t> all_;
+    std::vector<T> masses_;
+    std::vector<Vector<T>> positions_;
+    std::vector<Vector<T>> velocities_;
+    std::vector<Vector<T>> accelerations_;
+    std::vector<Vector<T>> jerks_;
+};
+
+} // namespace nbody
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include "core/Vector4.hpp"
+#include "simulators/Integrators.hpp"
+#include "simulators/NewtonianSimulator.hpp"
+#include "simulators/Simulator.hpp"
+
+
+
+namespace nbody {
+
+// Прямое суммирование для системы из N тел, известного на этапе компиляции.
+// Состояние хранится в std::array, цикл по парам развёрнут полностью, шаг не выделяет
+// памяти в куче. Предназначен для задач нескольких тел, в первую очередь в DoubleDouble.
+// При D = 2 компонента z тел не используется; трёхмерные векторы double хранятся
+// в выровненных Vector4, и операции над телом выполняются одной пачкой
+template <typename T, std::size_t N, typename Scheme = Leapfrog, std::size_t D = 3>
+class FixedNewtonianSimulator : public Simulator<T> {
+    static_assert(N >= 2, "FixedNewtonianSimulator needs at least two bodies");
+
+public:
+    using Point = StorageVector<T, D>;
+    using Vectors = std::array<Point, N>;
+
+    FixedNewtonianSimulator() = default;
+
+    void set_g(T g) override {
+        g_ = g;
+    }
+
+    bool step() override {
+        if (!this->system_) {
+            return false;
+        }
+        this->before_step();
+
+        if (!load()) {
+            return false;
+        }
+
+        T dt = this->clip_dt(this->dt_);
+        if (this->adaptive()) {
+            const T start_timescale = timescale(positions_, velocities_);
+            dt = this->clip_dt(this->eta_ * start_timescale);
+
+            // Пробный шаг на копии состояния, как в NewtonianSimulator
+            if (this->time_symmetric_) {
+                Vectors positions = positions_;
+                Vectors velocities = velocities_;
+                advance(positions, velocities, dt);
+                const T end_timescale = timescale(positions, velocities);
+                dt = this->clip_dt(this->eta_ * (start_timescale + end_timescale) * T{0.5});
+            }
+
+            if (!(dt > T{0})) {
+                std::cerr << "FixedNewtonianSimulator -- WARNING: адаптивный шаг выродился в ноль" << std::endl;
+                return false;
+            }
+        }
+
+        track_potential_ = tracks_potential();
+        advance(positions_, velocities_, dt);
+        track_potential_ = false;
+        store();
+        this->last_dt_ = dt;
+
+        this->after_step(dt);
+
+        return true;
+    }
+
+    // Пакет из n шагов постоянной длины на массивах состояния: тела читаются и пишутся
+    // один раз, граничные толчки (или дрейфы) соседних шагов слиты (for_each_operation).
+    // Если пакет невозможен (см. Simulator::batchable), шаги выполняются по одному
+    std::size_t run_steps(std::size_t n) override {
+        if (!this->batchable(n)) {
+            return Simulator<T>::run_steps(n);
+        }
+        this->before_step();
+        this->validation_failed_ = false;
+        if (!load()) {
+            return 0;
+        }
+
+        const T dt = this->clip_dt(this->dt_);
+        track_potential_ = tracks_potential();
+        advance(positions_, velocities_, dt, n);
+        track_potential_ = false;
+        store();
+        this->last_dt_ = dt;
+
+        const T elapsed = dt * T(double(n));
+        this->current_time_ += elapsed;
+        this->after_steps(dt, n);
+        return this->validate(n) ? n : 0;
+    }
+
+private:
+    bool load() {
+        const auto& bodies = this->system_->bodies();
+        if (bodies.size() != N) {
+            std::cerr << "FixedNewtonianSimulator -- WARNING: в системе " << bodies.size()
+                      << " тел вместо " << N << std::endl;
+            return false;
+        }
+
+        for (std::size_t i = 0; i < N; ++i) {
+            masses_[i] = bodies[i].mass();
+            positions_[i] = project<D>(bodies[i].position());
+            velocities_[i] = project<D>(bodies[i].velocity());
+        }
+        return true;
+    }
+
+    // Запись состояния в тела; попутно набираются суммы для проверки системы
+    // и сохраняется потенциальная энергия, если она считалась
+    void store() {
+        auto& bodies = this->system_->bodies();
+        this->step_totals_ = BodyTotals<T>{};
+        for (std::size_t i = 0; i < N; ++i) {
+            bodies[i].set_position(project<3>(positions_[i]));
+            bodies[i].set_velocity(project<3>(velocities_[i]));
+            this->step_totals_.add(masses_[i], bodies[i].position(), bodies[i].velocity());
+        }
+        this->step_totals_ready_ = true;
+        if (tracks_potential()) {
+            this->system_->store_potential_sum(potential_sum_);
+        }
+    }
+
+    // Последнее вычисление сил идёт на конечных положениях, если схема кончается толчком
+    bool tracks_potential() const {
+        return this->energy_tracking_ && Scheme::drift.back() == 0.0;
+    }
+
+    void advance(Vectors& positions, Vectors& velocities, T dt) {
+        static_assert(Scheme::drift.size() == Scheme::kick.size() + 1,
+                      "Scheme must have one more drift than kick coefficients");
+
+        [&]<std::size_t... Stage>(std::index_sequence<Stage...>) {
+            (stage<Stage>(positions, velocities, dt), ...);
+        }(std::make_index_sequence<Scheme::kick.size()>{});
+
+        if constexpr (Scheme::drift.back() != 0.0) {
+            drift(positions, velocities, dt * T{Scheme::drift.back()});
+        }
+    }
+
+    // Несколько шагов подряд со слиянием граничных операций соседних шагов
+    void advance(Vectors& positions, Vectors& velocities, T dt, std::size_t steps) {
+        for_each_operation<Scheme>(steps,
+            [&](double coefficient, bool) {
+                if (coefficient != 0.0) {
+                    drift(positions, velocities, dt * T{coefficient});
+                }
+            },
+            [&](double coefficient, bool) {
+                compute_accelerations(positions, accelerations_);
+                const T h = dt * T{coefficient};
+                for (std::size_t i = 0; i < N; ++i) {
+                    velocities[i].add_scaled(accelerations_[i], h);
+                }
+            });
+    }
+
+    template <std::size_t Stage>
+    void stage(Vectors& positions, Vectors& velocities, T dt) {
+        if constexpr (Scheme::drift[Stage] != 0.0) {
+            drift(positions, velocities, dt * T{Scheme::drift[Stage]});
+        }
+
+        compute_accelerations(positions, accelerations_);
+        const T h = dt * T{Scheme::kick[Stage]};
+        for (std::size_t i = 0; i < N; ++i) {
+            velocities[i].add_scaled(accelerations_[i], h);
+        }
+    }
+
+    static void drift(Vectors& positions, const Vectors& velocities, T h) {
+        for (std::size_t i = 0; i < N; ++i) {
+            positions[i].add_scaled(velocities[i], h);
+        }
+    }
+
+    void compute_accelerations(const Vectors& positions, Vectors& accelerations) const {
+        accelerations.fill(Point{});
+        potential_sum_ = T{0};
+        all_pairs(positions, accelerations, std::make_index_sequence<N - 1>{});
+    }
+
+    template <std::size_t... I>
+    void all_pairs(const Vectors& positions, Vectors& accelerations, std::index_sequence<I...>) const {
+        (row<I>(positions, accelerations, std::make_index_sequence<N - 1 - I>{}), ...);
+    }
+
+    template <std::size_t I, std::size_t... J>
+    void row(const Vectors& positions, Vectors& accelerations, std::index_sequence<J...>) const {
+        (add_pair<I, I + 1 + J>(positions, accelerations), ...);
+    }
+
+    template <std::size_t I, std::size_t J>
+    void add_pair(const Vectors& positions, Vectors& accelerations) const {
+        const Point r = positions[J] - positions[I];
+        const T distance_squared = r.magnitude_squared();
+
+        // Совпадающие тела: сила не определена, пара пропускается с предупреждением
+        if (distance_squared < T{1e-20}) {
+            if (!singular_warned_) {
+                std::cerr << "FixedNewtonianSimulator -- WARNING: тела " << I << " и " << J
+                          << " совпадают, сила между ними не учитывается" << std::endl;
+                singular_warned_ = true;
+            }
+            return;
+        }
+
+        const T distance = sqrt(distance_squared);
+        const Point scaled = r * (g_ / (distance_squared * distance));
+        accelerations[I].add_scaled(scaled, masses_[J]);
+        accelerations[J].add_scaled(scaled, -masses_[I]);
+        if (track_potential_) {
+            potential_sum_ += masses_[I] * masses_[J] / distance;
+        }
+    }
+
+    // Те же критерии, что у DirectSumForce::min_free_fall_time и min_acceleration_jerk_time
+    T timescale(const Vectors& positions, const Vectors& velocities) const {
+        T result = std::numeric_limits<double>::max();
+
+        if (this->criterion_ == TimeStepCriterion::AccelerationJerk) {
+            Vectors accelerations{};
+            Vectors jerks{};
+            for (std::size_t i = 0; i < N; ++i) {
+                for (std::size_t j = i + 1; j < N; ++j) {
+                    const Point r = positions[j] - positions[i];
+                    const Point v = velocities[j] - velocities[i];
+                    const T distance_squared = r.magnitude_squared();
+                    if (distance_squared < T{1e-20}) {
+                        continue;
+                    }
+
+                    const T inv_r3 = T{1} / (distance_squared * sqrt(distance_squared));
+                    const T rv = T{3} * dot(r, v) / distance_squared;
+                    const Point a = r * (g_ * inv_r3);
+                    const Point jerk = (v - r * rv) * (g_ * inv_r3);
+                    accelerations[i].add_scaled(a, masses_[j]);
+                    accelerations[j].add_scaled(a, -masses_[i]);
+                    jerks[i].add_scaled(jerk, masses_[j]);
+                    jerks[j].add_scaled(jerk, -masses_[i]);
+                }
+            }
+            for (std::size_t i = 0; i < N; ++i) {
+                const T acceleration = accelerations[i].magnitude();
+                const T jerk = jerks[i].magnitude();
+                if (acceleration > T{0} && jerk > T{0}) {
+                    result = std::min(result, T{acceleration / jerk});
+                }
+            }
+            return result;
+        }
+
+        for (std::size_t i = 0; i < N; ++i) {
+            for (std::size_t j = i + 1; j < N; ++j) {
+                const T distance_squared = (positions[j] - positions[i]).magnitude_squared();
+                if (distance_squared < T{1e-20}) {
+                    continue;
+                }
+
+                const T mass = g_ * (masses_[i] + masses_[j]);
+                if (mass > T{0}) {
+                    result = std::min(result, T{sqrt(distance_squared * sqrt(distance_squared) / mass)});
+                }
+                const T speed_squared = (velocities[j] - velocities[i]).magnitude_squared();
+                if (speed_squared > T{0}) {
+                    result = std::min(result, T{sqrt(distance_squared / speed_squared)});
+                }
+            }
+        }
+        return result;
+    }
+
+    T g_ = T{1};
+    mutable bool singular_warned_ = false;
+    bool track_potential_ = false;
+    mutable T potential_sum_ = T{0};    // Сумма m_i * m_j / r_ij при track_potential_
+    std::array<T, N> masses_{};
+    Vectors positions_{};
+    Vectors velocities_{};
+    Vectors accelerations_{};
+};
+
+// Число тел системы, если оно известно на этапе компиляции (SystemType::fixed_size), иначе 0
+template <typename SystemType>
+constexpr std::size_t fixed_body_count() {
+    if constexpr (requires { SystemType::fixed_size; }) {
+        return SystemType::fixed_size;
+    } else {
+        return 0;
+    }
+}
+
+// Размерность движения системы: 2 для плоских систем (SystemType::dimensions), иначе 3
+template <typename SystemType>
+constexpr std::size_t system_dimensions() {
+    if constexpr (requires { SystemType::dimensions; }) {
+        return SystemType::dimensions;
+    } else {
+        return 3;
+    }
+}
+
+// Симулятор прямого суммирования для системы: FixedNewtonianSimulator, если число тел
+// известно на этапе компиляции, иначе NewtonianSimulator; плоские системы считаются в 2D
+template <typename T, typename Scheme = Leapfrog, typename SystemType>
+std::unique_ptr<Simulator<T>> make_newtonian_simulator(const SystemType&) {
+    constexpr std::size_t n = fixed_body_count<SystemType>();
+    constexpr std::size_t d = system_dimensions<SystemType>();
+    if constexpr (n >= 2) {
+        return std::make_unique<FixedNewtonianSimulator<T, n, Scheme, d>>();
+    } else {
+        return std::make_unique<NewtonianSimulator<T, Scheme, d>>();
+    }
+}
+
+} // namespace nbody
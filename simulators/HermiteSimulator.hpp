@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "simulators/DirectSumForce.hpp"
+#include "simulators/Simulator.hpp"
+
+
+
+namespace nbody {
+
+// Схема Эрмита 4-го порядка с индивидуальными блочными шагами
+// Makino J., Aarseth S. (1992) "On a Hermite integrator with Ahmad-Cohen scheme..."
+//
+// Для каждого тела хранятся ускорение и его производная (jerk). Шаги тел -- dt / 2^k,
+// поэтому на каждом подшаге пересчитываются только тела, чей шаг закончился ("активные"),
+// остальные лишь экстраполируются. Время внутри кадра считается целыми тиками,
+// так что к концу step() все тела синхронизированы ровно на dt.
+template <typename T>
+class HermiteSimulator : public Simulator<T> {
+public:
+    static constexpr int max_level = 30;  // Наименьший шаг -- dt / 2^max_level
+
+    HermiteSimulator() = default;
+
+    void set_g(T g) override {
+        force_.set_g(g);
+        reset();
+    }
+
+    // Параметр точности критерия Аарсета
+    void set_accuracy(T eta) {
+        if (eta <= T{0}) {
+            throw std::invalid_argument("Accuracy must be positive");
+        }
+        eta_ = eta;
+    }
+
+    T accuracy() const {
+        return eta_;
+    }
+
+    // Число блочных подшагов и суммарное число обновлений отдельных тел
+    std::size_t block_steps() const {
+        return block_steps_;
+    }
+
+    std::size_t body_steps() const {
+        return body_steps_;
+    }
+
+    // Сброс ускорений и шагов; нужен, если тела системы изменены извне
+    void reset() {
+        initialized_ = false;
+    }
+
+    bool step() override {
+        if (!this->system_) {
+            return false;
+        }
+        this->before_step();
+
+        auto& bodies = this->system_->bodies();
+        if (bodies.empty()) {
+            return false;
+        }
+
+        const std::size_t n = bodies.size();
+        masses_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            masses_[i] = bodies[i].mass();
+        }
+        if (!initialized_ || positions_.size() != n) {
+            initialize(bodies);
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                positions_[i] = bodies[i].position();
+                velocities_[i] = bodies[i].velocity();
+            }
+        }
+
+        const std::uint64_t frame_ticks = std::uint64_t{1} << max_level;
+        const T tick = this->dt_ / T{double(frame_ticks)};
+        std::fill(times_.begin(), times_.end(), std::uint64_t{0});
+
+        std::uint64_t now = 0;
+        while (now < frame_ticks) {
+            std::uint64_t next = frame_ticks;
+            for (std::size_t i = 0; i < n; ++i) {
+                next = std::min(next, times_[i] + steps_[i]);
+            }
+
+            active_.clear();
+            for (std::size_t i = 0; i < n; ++i) {
+                if (times_[i] + steps_[i] == next) {
+                    active_.push_back(i);
+                }
+            }
+
+            predict(next, tick);
+            force_.compute_with_jerk(active_, predicted_positions_, predicted_velocities_, masses_,
+                                     new_accelerations_, new_jerks_);
+            for (std::size_t i : active_) {
+                if (!correct(i, next, tick)) {
+                    return false;
+                }
+            }
+
+            now = next;
+            ++block_steps_;
+            body_steps_ += active_.size();
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            bodies[i].set_position(positions_[i]);
+            bodies[i].set_velocity(velocities_[i]);
+        }
+
+        this->after_step(this->dt_);
+
+        return true;
+    }
+
+private:
+    void initialize(const std::vector<Body<T>>& bodies) {
+        const std::size_t n = bodies.size();
+        positions_.resize(n);
+        velocities_.resize(n);
+        predicted_positions_.resize(n);
+        predicted_velocities_.resize(n);
+        times_.assign(n, 0);
+        steps_.assign(n, 0);
+
+        active_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            positions_[i] = bodies[i].position();
+            velocities_[i] = bodies[i].velocity();
+            active_[i] = i;
+        }
+        force_.compute_with_jerk(active_, positions_, velocities_, masses_, accelerations_, jerks_);
+
+        // Стартовый шаг по упрощённому критерию |a| / |j|
+        const std::uint64_t frame_ticks = std::uint64_t{1} << max_level;
+        const T tick = this->dt_ / T{double(frame_ticks)};
+        for (std::size_t i = 0; i < n; ++i) {
+            const T a = accelerations_[i].magnitude();
+            const T j = jerks_[i].magnitude();
+            const T dt = (a > T{0} && j > T{0}) ? T{0.01} * a / j : this->dt_;
+            steps_[i] = quantize(dt / tick, frame_ticks, 0, frame_ticks);
+        }
+
+        initialized_ = true;
+    }
+
+    // Экстраполяция всех тел на момент time по рядам Тейлора
+    void predict(std::uint64_t time, T tick) {
+        for (std::size_t i = 0; i < positions_.size(); ++i) {
+            const T dt = T{double(time - times_[i])} * tick;
+            predicted_positions_[i] = positions_[i]
+                + (velocities_[i] + (accelerations_[i] * T{0.5} + jerks_[i] * (dt / T{6})) * dt) * dt;
+            predicted_velocities_[i] = velocities_[i]
+                + (accelerations_[i] + jerks_[i] * (dt * T{0.5})) * dt;
+        }
+    }
+
+    // Коррекция активного тела по интерполяционному полиному Эрмита и выбор нового шага
+    bool correct(std::size_t i, std::uint64_t time, T tick) {
+        const T dt = T{double(steps_[i])} * tick;
+        const T dt2 = dt * dt;
+
+        const Vector<T> a0 = accelerations_[i];
+        const Vector<T> j0 = jerks_[i];
+        const Vector<T> a1 = new_accelerations_[i];
+        const Vector<T> j1 = new_jerks_[i];
+
+        // Вторая и третья производные ускорения в начале шага
+        const Vector<T> snap = ((a0 - a1) * T{-6} - (j0 * T{4} + j1 * T{2}) * dt) / dt2;
+        const Vector<T> crackle = ((a0 - a1) * T{12} + (j0 + j1) * (T{6} * dt)) / (dt2 * dt);
+
+        positions_[i] = predicted_positions_[i]
+            + (snap * (dt2 * dt2 / T{24}) + crackle * (dt2 * dt2 * dt / T{120}));
+        velocities_[i] = predicted_velocities_[i]
+            + (snap * (dt2 * dt / T{6}) + crackle * (dt2 * dt2 / T{24}));
+        accelerations_[i] = a1;
+        jerks_[i] = j1;
+        times_[i] = time;
+
+        // Критерий Аарсета по производным в конце шага
+        const T a = a1.magnitude();
+        const T j = j1.magnitude();
+        const T s = (snap + crackle * dt).magnitude();
+        const T c = crackle.magnitude();
+        T proposed = this->dt_;
+        if (j * c + s * s > T{0}) {
+            proposed = sqrt(eta_ * (a * s + j * j) / (j * c + s * s));
+        }
+        if (!(proposed > T{0})) {
+            std::cerr << "HermiteSimulator -- WARNING: некорректная оценка шага тела " << i << std::endl;
+            return false;
+        }
+
+        const std::uint64_t frame_ticks = std::uint64_t{1} << max_level;
+        steps_[i] = quantize(proposed / tick, steps_[i] * 2, time, frame_ticks);
+        return true;
+    }
+
+    // Наибольшая степень двойки не больше desired (в тиках), не больше limit,
+    // и такая, чтобы новый шаг начинался на границе своего блока
+    std::uint64_t quantize(T desired, std::uint64_t limit, std::uint64_t time, std::uint64_t frame_ticks) {
+        std::uint64_t step = std::min(limit, frame_ticks);
+        while (step > 1 && (T{double(step)} > desired || time % step != 0)) {
+            step /= 2;
+        }
+        if (step == 1 && T{1} > desired && !min_step_warned_) {
+            std::cerr << "HermiteSimulator -- WARNING: требуемый шаг меньше dt / 2^"
+                      << max_level << ", точность не гарантируется" << std::endl;
+            min_step_warned_ = true;
+        }
+        return step;
+    }
+
+    DirectSumForce<T> force_;
+    T eta_ = T{0.02};
+    bool initialized_ = false;
+    bool min_step_warned_ = false;
+    std::size_t block_steps_ = 0;
+    std::size_t body_steps_ = 0;
+
+    std::vector<T> masses_;
+    std::vector<Vector<T>> positions_;
+    std::vector<Vector<T>> velocities_;
+    std::vector<Vector<T>> accelerations_;
+    std::vector<Vector<T>> jerks_;
+    std::vector<std::uint64_t> times_;       // Время последнего обновления тела, в тиках от начала кадра
+    std::vector<std::uint64_t> steps_;       // Индивидуальный шаг тела, в тиках
+
+    std::vector<std::size_t> active_;
+    std::vector<Vector<T>> predicted_positions_;
+    std::vector<Vector<T>> predicted_velocities_;
+    std::vector<Vector<T>> new_accelerations_;
+    std::vector<Vector<T>> new_jerks_;
+};
+
+} // namespace nbody
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "simulators/DirectSumForce.hpp"
+#include "simulators/Simulator.hpp"
+
+
+
+namespace nbody {
+
+// Интегратор 15-го порядка на разбиении Гаусса–Радо с адаптивным шагом (IAS15)
+// Rein H., Spiegel D. (2015) "IAS15: a fast, adaptive, high-order integrator
+// for gravitational dynamics, accurate to machine precision over a billion orbits"
+//
+// Ускорение на шаге приближается полиномом 7-й степени по времени; его коэффициенты
+// уточняются предиктор-корректором в узлах Гаусса–Радо. Величина старшего коэффициента
+// задаёт внутренний шаг, а step() всегда продвигает систему ровно на dt.
+template <typename T>
+class IAS15Simulator : public Simulator<T> {
+public:
+    IAS15Simulator() {
+        build_conversion_tables();
+    }
+
+    void set_g(T g) override {
+        force_.set_g(g);
+        reset();
+    }
+
+    // Допустимая относительная величина старшего члена разложения ускорения
+    void set_accuracy(T epsilon) {
+        if (epsilon <= T{0}) {
+            throw std::invalid_argument("Accuracy must be positive");
+        }
+        epsilon_ = epsilon;
+    }
+
+    T accuracy() const {
+        return epsilon_;
+    }
+
+    // Число принятых и отвергнутых внутренних шагов
+    std::size_t steps_taken() const {
+        return steps_taken_;
+    }
+
+    std::size_t steps_rejected() const {
+        return steps_rejected_;
+    }
+
+    std::size_t force_evaluations() const {
+        return force_evaluations_;
+    }
+
+    // Текущий внутренний шаг; до первого шага равен нулю
+    T internal_dt() const {
+        return internal_dt_;
+    }
+
+    // Сброс предсказанных коэффициентов; нужен, если тела системы изменены извне
+    void reset() {
+        initialized_ = false;
+    }
+
+    bool step() override {
+        if (!this->system_) {
+            return false;
+        }
+        this->before_step();
+
+        auto& bodies = this->system_->bodies();
+        if (bodies.empty()) {
+            return false;
+        }
+
+        if (!initialized_ || x0_.size() != bodies.size()) {
+            initialize(bodies.size());
+        }
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            masses_[i] = bodies[i].mass();
+            x0_[i] = bodies[i].position();
+            v0_[i] = bodies[i].velocity();
+        }
+
+        T remaining = this->dt_;
+        while (remaining > T{0}) {
+            // Шаг, почти дотягивающий до конца кадра, растягивается до него, чтобы не оставлять
+            // остаток порядка ошибки округления
+            const bool truncated = internal_dt_ * T{1.001} >= remaining;
+            T h = truncated ? remaining : internal_dt_;
+            T next_dt = h;
+            if (!integrate(h, next_dt)) {
+                return false;
+            }
+
+            remaining -= h;
+            // Укороченный шаг до конца кадра не должен уменьшать выбранный внутренний шаг
+            internal_dt_ = truncated ? std::min(internal_dt_, next_dt) : next_dt;
+        }
+
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            bodies[i].set_position(x0_[i]);
+            bodies[i].set_velocity(v0_[i]);
+        }
+
+        this->after_step(this->dt_);
+
+        return true;
+    }
+
+private:
+    static constexpr int order = 7;
+    static constexpr int max_predictor_corrector_iterations = 12;
+
+    // Узлы Гаусса–Радо на [0, 1]
+    static constexpr std::array<double, order + 1> nodes = {
+        0.0,
+        0.0562625605369221464656521910318,
+        0.180240691736892364987579942780,
+        0.352624717113169637373907769648,
+        0.547153626330555383001448554766,
+        0.734210177215410531523210605558,
+        0.885320946839095768090359771030,
+        0.977520613561287501891174488626
+    };
+
+    using Coefficients = std::array<std::vector<Vector<T>>, order>;
+
+    // Ускорение на шаге: a(t) = a0 + sum b_k t^(k+1) = a0 + sum g_j t (t - h_1)...(t - h_j).
+    // c_[j][k] переводит g в b, d_[k][j] -- b в g
+    void build_conversion_tables() {
+        for (auto& row : c_) row.fill(T{0});
+        for (auto& row : d_) row.fill(T{0});
+
+        // Коэффициенты произведения (t - h_1)...(t - h_j)
+        c_[0][0] = T{1};
+        for (int j = 1; j < order; ++j) {
+            for (int k = j; k >= 0; --k) {
+                c_[j][k] = (k > 0 ? c_[j - 1][k - 1] : T{0}) - T{nodes[j]} * c_[j - 1][k];
+            }
+        }
+
+        // t^k в базисе этих произведений: t * P_j = P_(j+1) + h_(j+1) * P_j
+        d_[0][0] = T{1};
+        for (int k = 1; k < order; ++k) {
+            for (int j = 0; j <= k; ++j) {
+                d_[k][j] = (j > 0 ? d_[k - 1][j - 1] : T{0}) + T{nodes[j + 1]} * d_[k - 1][j];
+            }
+        }
+    }
+
+    void initialize(std::size_t n) {
+        masses_.assign(n, T{0});
+        x0_.assign(n, Vector<T>{});
+        v0_.assign(n, Vector<T>{});
+        a0_.assign(n, Vector<T>{});
+        positions_.assign(n, Vector<T>{});
+        accelerations_.assign(n, Vector<T>{});
+        compensation_x_.assign(n, Vector<T>{});
+        compensation_v_.assign(n, Vector<T>{});
+        for (int k = 0; k < order; ++k) {
+            b_[k].assign(n, Vector<T>{});
+            e_[k].assign(n, Vector<T>{});
+            g_[k].assign(n, Vector<T>{});
+            accepted_b_[k].assign(n, Vector<T>{});
+            accepted_e_[k].assign(n, Vector<T>{});
+        }
+
+        internal_dt_ = this->dt_;
+        accepted_dt_ = T{0};
+        initialized_ = true;
+    }
+
+    // Один внутренний шаг; при отказе повторяется с меньшим h.
+    // Возвращает в h фактически сделанный шаг, в next_dt -- предлагаемый следующий
+    bool integrate(T& h, T& next_dt) {
+        using std::abs;
+
+        compute_accelerations(x0_, a0_);
+
+        for (;;) {
+            if (!(h > this->dt_ * T{1e-12})) {
+                std::cerr << "IAS15Simulator -- WARNING: внутренний шаг стал слишком мал" << std::endl;
+                return false;
+            }
+
+            predictor_corrector(h);
+
+            T max_b = T{0};
+            T max_a = T{0};
+            for (std::size_t i = 0; i < a0_.size(); ++i) {
+                for (std::size_t c = 0; c < Vector<T>::dimensions; ++c) {
+                    max_b = std::max(max_b, T{abs(b_[order - 1][i][c])});
+                    max_a = std::max(max_a, T{abs(a0_[i][c])});
+                }
+            }
+
+            // Шаг выбирается так, чтобы старший член разложения был порядка epsilon
+            T proposed = h / safety_factor_;
+            if (max_a > T{0} && max_b > T{0}) {
+                const double ratio = double(epsilon_ * max_a / max_b);
+                proposed = std::min(proposed, h * T{std::pow(ratio, 1.0 / order)});
+            }
+            if (!(proposed > T{0})) {
+                std::cerr << "IAS15Simulator -- WARNING: некорректная оценка погрешности шага" << std::endl;
+                return false;
+            }
+
+            if (proposed < h * safety_factor_) {
+                ++steps_rejected_;
+                h = proposed;
+                if (accepted_dt_ > T{0}) {
+                    predict_coefficients(h / accepted_dt_, accepted_e_, accepted_b_);
+                } else {
+                    clear_coefficients();
+                }
+                continue;
+            }
+
+            advance_state(h);
+            ++steps_taken_;
+
+            accepted_b_ = b_;
+            accepted_e_ = e_;
+            accepted_dt_ = h;
+            next_dt = proposed;
+            predict_coefficients(next_dt / h, accepted_e_, accepted_b_);
+            return true;
+        }
+    }
+
+    // Итерации предиктор-корректора: положения в узлах по текущим b, новые ускорения
+    // уточняют g (разделённые разности), изменения g пересчитываются в b
+    void predictor_corrector(T h) {
+        using std::abs;
+
+        const T tolerance = std::numeric_limits<T>::is_specialized ? T{1e-16} : T{1e-30};
+        const std::size_t n = x0_.size();
+
+        for (int j = 0; j < order; ++j) {
+            for (std::size_t i = 0; i < n; ++i) {
+                Vector<T> value{};
+                for (int k = j; k < order; ++k) {
+                    value += b_[k][i] * d_[k][j];
+                }
+                g_[j][i] = value;
+            }
+        }
+
+        T error = T{2};
+        T last_error = T{3};
+        for (int iter = 0; iter < max_predictor_corrector_iterations; ++iter) {
+            if (error < tolerance || (iter > 2 && error >= last_error)) {
+                break;
+            }
+            last_error = error;
+
+            for (int stage = 1; stage <= order; ++stage) {
+                const T s = T{nodes[stage]};
+                for (std::size_t i = 0; i < n; ++i) {
+                    Vector<T> sum{};
+                    for (int k = order - 1; k >= 0; --k) {
+                        sum = (sum + b_[k][i] / T{double((k + 2) * (k + 3))}) * s;
+                    }
+                    sum += a0_[i] * T{0.5};
+                    positions_[i] = x0_[i] + v0_[i] * (s * h) + sum * (s * s * h * h);
+                }
+
+                compute_accelerations(positions_, accelerations_);
+
+                T max_delta = T{0};
+                T max_a = T{0};
+                for (std::size_t i = 0; i < n; ++i) {
+                    Vector<T> value = (accelerations_[i] - a0_[i]) / s;
+                    for (int j = 0; j < stage - 1; ++j) {
+                        value = (value - g_[j][i]) / (s - T{nodes[j + 1]});
+                    }
+
+                    const Vector<T> delta = value - g_[stage - 1][i];
+                    g_[stage - 1][i] = value;
+                    for (int k = 0; k < stage; ++k) {
+                        b_[k][i] += delta * c_[stage - 1][k];
+                    }
+
+                    if (stage == order) {
+                        for (std::size_t c = 0; c < Vector<T>::dimensions; ++c) {
+                            max_delta = std::max(max_delta, T{abs(delta[c])});
+                            max_a = std::max(max_a, T{abs(accelerations_[i][c])});
+                        }
+                    }
+                }
+
+                if (stage == order) {
+                    error = max_a > T{0} ? max_delta / max_a : T{0};
+                }
+            }
+        }
+    }
+
+    // Положения и скорости в конце шага; приращения складываются с компенсацией (Kahan)
+    void advance_state(T h) {
+        for (std::size_t i = 0; i < x0_.size(); ++i) {
+            Vector<T> dx{};
+            Vector<T> dv{};
+            for (int k = order - 1; k >= 0; --k) {
+                dx += b_[k][i] / T{double((k + 2) * (k + 3))};
+                dv += b_[k][i] / T{double(k + 2)};
+            }
+            dx = v0_[i] * h + (dx + a0_[i] * T{0.5}) * (h * h);
+            dv = (dv + a0_[i]) * h;
+
+            for (std::size_t c = 0; c < Vector<T>::dimensions; ++c) {
+                add_compensated(x0_[i][c], compensation_x_[i][c], dx[c]);
+                add_compensated(v0_[i][c], compensation_v_[i][c], dv[c]);
+            }
+        }
+    }
+
+    static void add_compensated(T& sum, T& compensation, T increment) {
+        const T y = increment - compensation;
+        const T t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+
+    // Коэффициенты следующего шага, длиннее прошлого в q раз: полином ускорения
+    // переразлагается в начале нового шага, к нему добавляется поправка, которую внёс
+    // корректор к прошлому предсказанию
+    void predict_coefficients(T q, const Coefficients& previous_e, const Coefficients& previous_b) {
+        if (q > T{20}) {
+            clear_coefficients();
+            return;
+        }
+
+        std::array<T, order> q_power;
+        q_power[0] = q;
+        for (int k = 1; k < order; ++k) {
+            q_power[k] = q_power[k - 1] * q;
+        }
+
+        for (std::size_t i = 0; i < x0_.size(); ++i) {
+            for (int k = 0; k < order; ++k) {
+                Vector<T> predicted{};
+                for (int j = k; j < order; ++j) {
+                    predicted += previous_b[j][i] * T{double(binomial(j + 1, k + 1))};
+                }
+                predicted *= q_power[k];
+
+                const Vector<T> correction = previous_b[k][i] - previous_e[k][i];
+                e_[k][i] = predicted;
+                b_[k][i] = predicted + correction;
+            }
+        }
+    }
+
+    void clear_coefficients() {
+        for (int k = 0; k < order; ++k) {
+            std::fill(b_[k].begin(), b_[k].end(), Vector<T>{});
+            std::fill(e_[k].begin(), e_[k].end(), Vector<T>{});
+        }
+    }
+
+    static constexpr int binomial(int n, int k) {
+        int result = 1;
+        for (int i = 1; i <= k; ++i) {
+            result = result * (n - k + i) / i;
+        }
+        return result;
+    }
+
+    void compute_accelerations(const std::vector<Vector<T>>& positions, std::vector<Vector<T>>& accelerations) {
+        force_.compute(positions, masses_, accelerations);
+        ++force_evaluations_;
+    }
+
+    DirectSumForce<T> force_;
+    T epsilon_ = T{1e-9};
+    T safety_factor_ = T{0.25};
+
+    bool initialized_ = false;
+    T internal_dt_ = T{0};
+    T accepted_dt_ = T{0};                   // Последний принятый внутренний шаг
+    std::size_t steps_taken_ = 0;
+    std::size_t steps_rejected_ = 0;
+    std::size_t force_evaluations_ = 0;
+
+    std::array<std::array<T, order>, order> c_;
+    std::array<std::array<T, order>, order> d_;
+
+    std::vector<T> masses_;
+    std::vector<Vector<T>> x0_;
+    std::vector<Vector<T>> v0_;
+    std::vector<Vector<T>> a0_;
+    std::vector<Vector<T>> positions_;
+    std::vector<Vector<T>> accelerations_;
+    std::vector<Vector<T>> compensation_x_;
+    std::vector<Vector<T>> compensation_v_;
+
+    Coefficients b_;                         // Коэффициенты полинома ускорения
+    Coefficients e_;                         // Их предсказание на начало шага
+    Coefficients g_;                         // Те же коэффициенты в форме разделённых разностей
+    Coefficients accepted_b_;
+    Coefficients accepted_e_;
+};
+
+} // namespace nbody
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/Vector.hpp"
+
+
+
+namespace nbody {
+
+// Симплектические схемы как политики времени компиляции.
+// Шаг схемы -- композиция дрейфов и толчков:
+//   D(drift[0]) K(kick[0]) D(drift[1]) K(kick[1]) ... K(kick[n-1]) D(drift[n]),
+// где D(c): x += c*v*dt, K(d): v += d*a(x)*dt. Каждый толчок требует одного вычисления сил.
+
+// Leapfrog в форме "толчок-дрейф-толчок", 2-й порядок
+struct Leapfrog {
+    static constexpr int order = 2;
+    static constexpr std::array<double, 3> drift = {0.0, 1.0, 0.0};
+    static constexpr std::array<double, 2> kick = {0.5, 0.5};
+};
+
+// Полунеявный метод Эйлера: толчок, затем дрейф с новой скоростью, 1-й порядок
+struct SymplecticEuler {
+    static constexpr int order = 1;
+    static constexpr std::array<double, 2> drift = {0.0, 1.0};
+    static constexpr std::array<double, 1> kick = {1.0};
+};
+
+// Тройная композиция leapfrog (скоростная форма), 4-й порядок
+// Yoshida H. (1990) "Construction of higher order symplectic integrators"
+struct Yoshida4 {
+    static constexpr double w1 = 1.3512071919596578;   // 1 / (2 - 2^(1/3))
+    static constexpr double w0 = -1.7024143839193155;  // 1 - 2*w1
+
+    static constexpr int order = 4;
+    static constexpr std::array<double, 5> drift = {0.0, w1, w0, w1, 0.0};
+    static constexpr std::array<double, 4> kick = {w1 / 2, (w1 + w0) / 2, (w0 + w1) / 2, w1 / 2};
+};
+
+// Композиция семи шагов leapfrog, 6-й порядок (решение A Йошиды)
+struct Yoshida6 {
+    static constexpr double w1 = -1.17767998417887;
+    static constexpr double w2 = 0.235573213359357;
+    static constexpr double w3 = 0.784513610477560;
+    static constexpr double w0 = 1.0 - 2.0 * (w1 + w2 + w3);
+
+    static constexpr int order = 6;
+    static constexpr std::array<double, 8> drift = {
+        w3 / 2, (w3 + w2) / 2, (w2 + w1) / 2, (w1 + w0) / 2,
+        (w0 + w1) / 2, (w1 + w2) / 2, (w2 + w3) / 2, w3 / 2
+    };
+    static constexpr std::array<double, 7> kick = {w3, w2, w1, w0, w1, w2, w3};
+};
+
+// Позиционная форма схемы 4-го порядка, три вычисления сил за шаг
+// Forest E., Ruth R. (1990) "Fourth-order symplectic integration"
+struct ForestRuth {
+    static constexpr double theta = 1.3512071919596578;  // 1 / (2 - 2^(1/3))
+
+    static constexpr int order = 4;
+    static constexpr std::array<double, 4> drift = {
+        theta / 2, (1.0 - theta) / 2, (1.0 - theta) / 2, theta / 2
+    };
+    static constexpr std::array<double, 3> kick = {theta, 1.0 - 2.0 * theta, theta};
+};
+
+// Position-extended Forest-Ruth-like, 4-й порядок с ошибкой на два порядка меньше Forest-Ruth
+// Omelyan I., Mryglod I., Folk R. (2002) "Optimized Forest-Ruth- and Suzuki-like algorithms..."
+struct PEFRL {
+    static constexpr double xi = 0.1786178958448091;
+    static constexpr double lambda = -0.2123418310626054;
+    static constexpr double chi = -0.6626458266981849e-1;
+
+    static constexpr int order = 4;
+    static constexpr std::array<double, 5> drift = {xi, chi, 1.0 - 2.0 * (chi + xi), chi, xi};
+    static constexpr std::array<double, 4> kick = {
+        (1.0 - 2.0 * lambda) / 2, lambda, lambda, (1.0 - 2.0 * lambda) / 2
+    };
+};
+
+// Компенсированное прибавление по Кэхэну: compensation накапливает (со знаком минус)
+// младшие разряды приращений, потерянные при округлении value, и возвращает их в
+// следующее прибавление. Ошибка округления перестаёт расти с числом шагов.
+// Приращение -- direction * scalar, промежуточный вектор не создаётся
+template <typename V, typename T>
+void compensated_add(V& value, V& compensation, const V& direction, T scalar) {
+    for (std::size_t d = 0; d < V::dimensions; ++d) {
+        const T y = direction[d] * scalar - compensation[d];
+        const T t = value[d] + y;
+        compensation[d] = (t - value[d]) - y;
+        value[d] = t;
+    }
+}
+
+// Поправки компенсированного суммирования: младшие разряды положений и скоростей,
+// потерянные при округлении. Хранятся симулятором параллельно массиву тел или состояния,
+// а не в Body, чтобы не увеличивать тело ради режима, который включён не всегда
+template <typename V>
+struct Compensation {
+    std::vector<V> positions;
+    std::vector<V> velocities;
+
+    // Поправки для n тел; при изменении числа тел (слияние) прежние поправки теряют
+    // смысл и обнуляются -- это стоит одной ошибки округления
+    void resize(std::size_t n) {
+        if (positions.size() != n) {
+            positions.assign(n, V{});
+            velocities.assign(n, V{});
+        }
+    }
+};
+
+// Последовательность дрейфов и толчков steps шагов схемы подряд. Граничные операции
+// соседних шагов сливаются: если схема начинается и кончается толчком (drift.front() ==
+// drift.back() == 0), последний толчок шага и первый толчок следующего идут на одних
+// положениях и выполняются одним толчком -- на шаг приходится на одно вычисление сил
+// меньше; иначе последний дрейф шага и первый дрейф следующего сливаются в один.
+// drift(coefficient, final), kick(coefficient, final): final -- последняя операция вида
+template <typename Scheme, typename DriftFn, typename KickFn>
+void for_each_operation(std::size_t steps, DriftFn&& drift, KickFn&& kick) {
+    static_assert(Scheme::drift.size() == Scheme::kick.size() + 1,
+                  "Scheme must have one more drift than kick coefficients");
+    constexpr std::size_t stages = Scheme::kick.size();
+    constexpr bool fuse_kicks = Scheme::drift.front() == 0.0 && Scheme::drift.back() == 0.0;
+
+    for (std::size_t step = 0; step < steps; ++step) {
+        const bool first = step == 0;
+        const bool last = step + 1 == steps;
+        for (std::size_t stage = 0; stage < stages; ++stage) {
+            if (fuse_kicks && stage == 0 && !first) {
+                continue;  // Толчок уже выполнен вместе с последним толчком прошлого шага
+            }
+
+            double drift_coefficient = Scheme::drift[stage];
+            if (!fuse_kicks && stage == 0 && !first) {
+                drift_coefficient += Scheme::drift.back();
+            }
+            drift(drift_coefficient, false);
+
+            double kick_coefficient = Scheme::kick[stage];
+            if (fuse_kicks && stage + 1 == stages && !last) {
+                kick_coefficient += Scheme::kick.front();
+            }
+            kick(kick_coefficient, last && stage + 1 == stages);
+        }
+    }
+    if (steps > 0) {
+        drift(Scheme::drift.back(), true);
+    }
+}
+
+// steps шагов схемы Scheme подряд (см. for_each_operation). compute_accelerations(bodies,
+// accelerations) -- источник сил (прямое суммирование, PM-сетка и т.п.), вызывается перед
+// каждым толчком. Если передан compensation (размером с bodies), дрейфы и толчки
+// прибавляются через compensated_add с его поправками. Если передан totals, в него попадают суммы по телам на конце
+// последнего шага: масса и импульс набираются в последнем толчке, sum m * x -- в последнем
+// дрейфе, без отдельного прохода. V -- тип векторов тел (Vector<T> или Vector4<T>)
+template <typename Scheme, typename T, typename V, typename AccelerationFn>
+void symplectic_steps(std::vector<Body<T, V>>& bodies, T dt, std::size_t steps, std::vector<V>& accelerations,
+                      AccelerationFn&& compute_accelerations, Compensation<V>* compensation = nullptr,
+                      BodyTotals<T, V>* totals = nullptr) {
+    constexpr bool ends_with_kick = Scheme::drift.back() == 0.0;
+    if (totals) {
+        *totals = BodyTotals<T, V>{};
+    }
+
+    auto drift = [&](double coefficient, bool final) {
+        if (coefficient == 0.0) {
+            return;
+        }
+        BodyTotals<T, V>* positions_total = final && !ends_with_kick ? totals : nullptr;
+        const T h = dt * T{coefficient};
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            auto& body = bodies[i];
+            if (compensation) {
+                compensated_add(body.position(), compensation->positions[i], body.velocity(), h);
+            } else {
+                body.position().add_scaled(body.velocity(), h);
+            }
+            if (positions_total) {
+                positions_total->mass_position.add_scaled(body.position(), body.mass());
+            }
+        }
+    };
+
+    auto kick = [&](double coefficient, bool final) {
+        compute_accelerations(bodies, accelerations);
+        BodyTotals<T, V>* kick_total = final ? totals : nullptr;
+        const T h = dt * T{coefficient};
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            if (compensation) {
+                compensated_add(bodies[i].velocity(), compensation->velocities[i], accelerations[i], h);
+            } else {
+                bodies[i].velocity().add_scaled(accelerations[i], h);
+            }
+            if (kick_total) {
+                const T mass = bodies[i].mass();
+                kick_total->mass += mass;
+                kick_total->momentum.add_scaled(bodies[i].velocity(), mass);
+                if (ends_with_kick) {
+                    kick_total->mass_position.add_scaled(bodies[i].position(), mass);
+                }
+            }
+        }
+    };
+
+    for_each_operation<Scheme>(steps, drift, kick);
+}
+
+// Один шаг схемы Scheme
+template <typename Scheme, typename T, typename V, typename AccelerationFn>
+void symplectic_step(std::vector<Body<T, V>>& bodies, T dt, std::vector<V>& accelerations,
+                     AccelerationFn&& compute_accelerations, Compensation<V>* compensation = nullptr,
+                     BodyTotals<T, V>* totals = nullptr) {
+    symplectic_steps<Scheme>(bodies, dt, 1, accelerations, compute_accelerations, compensation, totals);
+}
+
+// Те же шаги для состояния в виде отдельных массивов положений и скоростей
+// (например, плоских векторов Vector<T, 2>); compute_accelerations(positions, accelerations).
+// Если передан compensation, обновления компенсированные
+template <typename Scheme, typename T, std::size_t D, typename AccelerationFn>
+void symplectic_steps(std::vector<Vector<T, D>>& positions, std::vector<Vector<T, D>>& velocities, T dt,
+                      std::size_t steps, std::vector<Vector<T, D>>& accelerations,
+                      AccelerationFn&& compute_accelerations, Compensation<Vector<T, D>>* compensation = nullptr) {
+    auto drift = [&](double coefficient, bool) {
+        if (coefficient == 0.0) {
+            return;
+        }
+        const T h = dt * T{coefficient};
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            if (compensation) {
+                compensated_add(positions[i], compensation->positions[i], velocities[i], h);
+            } else {
+                positions[i].add_scaled(velocities[i], h);
+            }
+        }
+    };
+
+    auto kick = [&](double coefficient, bool) {
+        compute_accelerations(positions, accelerations);
+        const T h = dt * T{coefficient};
+        for (std::size_t i = 0; i < velocities.size(); ++i) {
+            if (compensation) {
+                compensated_add(velocities[i], compensation->velocities[i], accelerations[i], h);
+            } else {
+                velocities[i].add_scaled(accelerations[i], h);
+            }
+        }
+    };
+
+    for_each_operation<Scheme>(steps, drift, kick);
+}
+
+template <typename Scheme, typename T, std::size_t D, typename AccelerationFn>
+void symplectic_step(std::vector<Vector<T, D>>& positions, std::vector<Vector<T, D>>& velocities, T dt,
+                     std::vector<Vector<T, D>>& accelerations, AccelerationFn&& compute_accelerations,
+                     Compensation<Vector<T, D>>* compensation = nullptr) {
+    symplectic_steps<Scheme>(positions, velocities, dt, 1, accelerations, compute_accelerations, compensation);
+}
+
+} // namespace nbody
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/Vector.hpp"
+#include "simulators/Integrators.hpp"
+
+
+
+namespace nbody {
+
+// Относительное движение пары в переменных Кустаанхеймо–Штифеля
+// Stiefel E., Scheifele G. (1971) "Linear and Regular Celestial Mechanics"
+//
+// Координаты x = L(u) u, время dt = r ds. В этих переменных невозмущённая задача
+// двух тел -- гармонический осциллятор без особенности при r -> 0; возмущение
+// учитывается через полную энергию h, которая интегрируется вместе с u.
+template <typename T>
+class KSTwoBody {
+public:
+    using Vector4 = std::array<T, 4>;
+
+    // Продвижение относительного положения r и скорости v на время dt.
+    // mu = G*(m1 + m2), perturbation(t, r) -- возмущающее относительное ускорение
+    template <typename Perturbation>
+    static bool advance(Vector<T>& position, Vector<T>& velocity, T mu, T dt, int steps_per_orbit,
+                        Perturbation&& perturbation) {
+        using std::abs;
+
+        State state;
+        state.u = to_ks(position);
+        state.w = transpose_product(state.u, velocity * T{0.5});
+        state.h = velocity.magnitude_squared() * T{0.5} - mu / position.magnitude();
+        state.t = T{0};
+
+        const T tolerance = std::numeric_limits<T>::is_specialized
+            ? T{64} * std::numeric_limits<T>::epsilon()
+            : T{1e-28};
+        const T pi2 = T{2} * T{M_PI};
+
+        for (int iter = 0; iter < max_iterations; ++iter) {
+            const T remaining = dt - state.t;
+            if (abs(remaining) <= tolerance * dt) {
+                position = from_ks(state.u);
+                velocity = product(state.u, state.w) * (T{2} / radius(state.u));
+                return true;
+            }
+
+            // Шаг по фиктивному времени -- доля периода осциллятора; у конца интервала
+            // шаг подбирается по dt/ds = r, чтобы попасть точно в dt
+            const T r = radius(state.u);
+            T ds = pi2 / T{double(steps_per_orbit)} / sqrt(abs(state.h) * T{0.5} + mu / (T{2} * r));
+            if (r * ds >= remaining) {
+                ds = remaining / r;
+            }
+            rk4_step(state, ds, perturbation);
+        }
+
+        std::cerr << "KSTwoBody -- WARNING: не удалось проинтегрировать пару за "
+                  << max_iterations << " шагов" << std::endl;
+        return false;
+    }
+
+private:
+    static constexpr int max_iterations = 1000000;
+
+    struct State {
+        Vector4 u;
+        Vector4 w;   // du/ds
+        T h;         // Энергия относительного движения на единицу приведённой массы
+        T t;         // Физическое время
+    };
+
+    static T radius(const Vector4& u) {
+        return u[0] * u[0] + u[1] * u[1] + u[2] * u[2] + u[3] * u[3];
+    }
+
+    static Vector4 to_ks(const Vector<T>& x) {
+        const T r = x.magnitude();
+        Vector4 u{};
+        if (x.x() >= T{0}) {
+            u[0] = sqrt((r + x.x()) * T{0.5});
+            u[1] = x.y() / (T{2} * u[0]);
+            u[2] = x.z() / (T{2} * u[0]);
+            u[3] = T{0};
+        } else {
+            u[1] = sqrt((r - x.x()) * T{0.5});
+            u[0] = x.y() / (T{2} * u[1]);
+            u[3] = x.z() / (T{2} * u[1]);
+            u[2] = T{0};
+        }
+        return u;
+    }
+
+    // Первые три компоненты L(u) w
+    static Vector<T> product(const Vector4& u, const Vector4& w) {
+        return Vector<T>(u[0] * w[0] - u[1] * w[1] - u[2] * w[2] + u[3] * w[3],
+                         u[1] * w[0] + u[0] * w[1] - u[3] * w[2] - u[2] * w[3],
+                         u[2] * w[0] + u[3] * w[1] + u[0] * w[2] + u[1] * w[3]);
+    }
+
+    static Vector<T> from_ks(const Vector4& u) {
+        return product(u, u);
+    }
+
+    // L(u)^T (p, 0)
+    static Vector4 transpose_product(const Vector4& u, const Vector<T>& p) {
+        return Vector4{
+            u[0] * p.x() + u[1] * p.y() + u[2] * p.z(),
+            -u[1] * p.x() + u[0] * p.y() + u[3] * p.z(),
+            -u[2] * p.x() - u[3] * p.y() + u[0] * p.z(),
+            u[3] * p.x() - u[2] * p.y() + u[1] * p.z()
+        };
+    }
+
+    // u'' = h/2 u + r/2 L^T P,  h' = 2 u' . L^T P,  t' = r
+    template <typename Perturbation>
+    static State derivative(const State& state, Perturbation& perturbation) {
+        const T r = radius(state.u);
+        const Vector<T> p = perturbation(state.t, from_ks(state.u));
+        const Vector4 lp = transpose_product(state.u, p);
+
+        State result;
+        T power = T{0};
+        for (int k = 0; k < 4; ++k) {
+            result.u[k] = state.w[k];
+            result.w[k] = state.h * T{0.5} * state.u[k] + r * T{0.5} * lp[k];
+            power += state.w[k] * lp[k];
+        }
+        result.h = T{2} * power;
+        result.t = r;
+        return result;
+    }
+
+    static State combine(const State& state, const State& derivative, T ds) {
+        State result;
+        for (int k = 0; k < 4; ++k) {
+            result.u[k] = state.u[k] + derivative.u[k] * ds;
+            result.w[k] = state.w[k] + derivative.w[k] * ds;
+        }
+        result.h = state.h + derivative.h * ds;
+        result.t = state.t + derivative.t * ds;
+        return result;
+    }
+
+    template <typename Perturbation>
+    static void rk4_step(State& state, T ds, Perturbation& perturbation) {
+        const State k1 = derivative(state, perturbation);
+        const State k2 = derivative(combine(state, k1, ds * T{0.5}), perturbation);
+        const State k3 = derivative(combine(state, k2, ds * T{0.5}), perturbation);
+        const State k4 = derivative(combine(state, k3, ds), perturbation);
+
+        const T sixth = ds / T{6};
+        for (int k = 0; k < 4; ++k) {
+            state.u[k] += (k1.u[k] + T{2} * (k2.u[k] + k3.u[k]) + k4.u[k]) * sixth;
+            state.w[k] += (k1.w[k] + T{2} * (k2.w[k] + k3.w[k]) + k4.w[k]) * sixth;
+        }
+        state.h += (k1.h + T{2} * (k2.h + k3.h) + k4.h) * sixth;
+        state.t += (k1.t + T{2} * (k2.t + k3.t) + k4.t) * sixth;
+    }
+};
+
+// Автоматическая регуляризация тесных пар.
+// Пара, чьё время свободного падения меньше factor глобальных шагов, заменяется на
+// псевдотело в её центре масс; глобальная схема двигает псевдотело вместе с остальными,
+// а относительное движение пары интегрируется отдельно в KS-переменных с приливным
+// возмущением от остальных тел
+template <typename T>
+class PairRegularization {
+public:
+    void set_factor(T factor) {
+        factor_ = factor;
+    }
+
+    T factor() const {
+        return factor_;
+    }
+
+    void set_steps_per_orbit(int steps) {
+        steps_per_orbit_ = std::max(8, steps);
+    }
+
+    std::size_t pair_count() const {
+        return pairs_.size();
+    }
+
+    // Поиск тесных пар и построение укороченного набора тел. false -- пар нет
+    bool pack(const std::vector<Body<T>>& bodies, T dt, T g) {
+        g_ = g;
+        find_pairs(bodies, dt);
+        if (pairs_.empty()) {
+            return false;
+        }
+
+        reduced_.clear();
+        slots_.assign(bodies.size(), 0);
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            if (partner_[i] == unpaired) {
+                slots_[i] = reduced_.size();
+                reduced_.push_back(bodies[i]);
+            }
+        }
+        for (auto& pair : pairs_) {
+            const Body<T>& a = bodies[pair.first];
+            const Body<T>& b = bodies[pair.second];
+            const T mass = a.mass() + b.mass();
+
+            pair.slot = reduced_.size();
+            pair.position = b.position() - a.position();
+            pair.velocity = b.velocity() - a.velocity();
+            pair.mass_first = a.mass();
+            pair.mass_second = b.mass();
+            reduced_.push_back(Body<T>(mass,
+                (a.position() * a.mass() + b.position() * b.mass()) / mass,
+                (a.velocity() * a.mass() + b.velocity() * b.mass()) / mass));
+        }
+
+        start_positions_.resize(reduced_.size());
+        for (std::size_t k = 0; k < reduced_.size(); ++k) {
+            start_positions_[k] = reduced_[k].position();
+        }
+        return true;
+    }
+
+    std::vector<Body<T>>& reduced() {
+        return reduced_;
+    }
+
+    // Относительное движение пар за шаг dt; положения остальных тел внутри шага
+    // интерполируются между началом и концом глобального шага
+    bool advance_pairs(T dt) {
+        for (auto& pair : pairs_) {
+            const T mass = pair.mass_first + pair.mass_second;
+            auto perturbation = [&](T t, const Vector<T>& relative) {
+                const T fraction = t / dt;
+                const Vector<T> center = start_positions_[pair.slot]
+                    + (reduced_[pair.slot].position() - start_positions_[pair.slot]) * fraction;
+                const Vector<T> first = center - relative * (pair.mass_second / mass);
+                const Vector<T> second = center + relative * (pair.mass_first / mass);
+
+                Vector<T> result{};
+                for (std::size_t k = 0; k < reduced_.size(); ++k) {
+                    if (k == pair.slot) {
+                        continue;
+                    }
+                    const Vector<T> source = start_positions_[k]
+                        + (reduced_[k].position() - start_positions_[k]) * fraction;
+                    result += pull(source, second, reduced_[k].mass()) - pull(source, first, reduced_[k].mass());
+                }
+                return result;
+            };
+
+            if (!KSTwoBody<T>::advance(pair.position, pair.velocity, g_ * mass, dt,
+                                       steps_per_orbit_, perturbation)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Запись результата обратно в исходный набор тел
+    void unpack(std::vector<Body<T>>& bodies) const {
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            if (partner_[i] == unpaired) {
+                bodies[i].set_position(reduced_[slots_[i]].position());
+                bodies[i].set_velocity(reduced_[slots_[i]].velocity());
+            }
+        }
+        for (const auto& pair : pairs_) {
+            const Body<T>& center = reduced_[pair.slot];
+            const T mass = pair.mass_first + pair.mass_second;
+            const T share_first = -(pair.mass_second / mass);
+            const T share_second = pair.mass_first / mass;
+            bodies[pair.first].position().fma_assign(center.position(), pair.position, share_first);
+            bodies[pair.first].velocity().fma_assign(center.velocity(), pair.velocity, share_first);
+            bodies[pair.second].position().fma_assign(center.position(), pair.position, share_second);
+            bodies[pair.second].velocity().fma_assign(center.velocity(), pair.velocity, share_second);
+        }
+    }
+
+    // Поправки компенсированного суммирования для укороченного набора: одиночные тела
+    // сохраняют свои, псевдотело пары получает взвешенные по массам поправки её тел
+    template <typename V>
+    void pack_compensation(const Compensation<V>& full, Compensation<V>& reduced) const {
+        reduced.positions.resize(reduced_.size());
+        reduced.velocities.resize(reduced_.size());
+        for (std::size_t i = 0; i < partner_.size(); ++i) {
+            if (partner_[i] == unpaired) {
+                reduced.positions[slots_[i]] = full.positions[i];
+                reduced.velocities[slots_[i]] = full.velocities[i];
+            }
+        }
+        for (const auto& pair : pairs_) {
+            const T mass = pair.mass_first + pair.mass_second;
+            reduced.positions[pair.slot] = (full.positions[pair.first] * pair.mass_first
+                + full.positions[pair.second] * pair.mass_second) / mass;
+            reduced.velocities[pair.slot] = (full.velocities[pair.first] * pair.mass_first
+                + full.velocities[pair.second] * pair.mass_second) / mass;
+        }
+    }
+
+    // Обратная запись поправок: тела пары получают поправку её псевдотела, так как
+    // относительное движение пары считается без компенсации
+    template <typename V>
+    void unpack_compensation(const Compensation<V>& reduced, Compensation<V>& full) const {
+        for (std::size_t i = 0; i < partner_.size(); ++i) {
+            if (partner_[i] == unpaired) {
+                full.positions[i] = reduced.positions[slots_[i]];
+                full.velocities[i] = reduced.velocities[slots_[i]];
+            }
+        }
+        for (const auto& pair : pairs_) {
+            full.positions[pair.first] = reduced.positions[pair.slot];
+            full.positions[pair.second] = reduced.positions[pair.slot];
+            full.velocities[pair.first] = reduced.velocities[pair.slot];
+            full.velocities[pair.second] = reduced.velocities[pair.slot];
+        }
+    }
+
+private:
+    static constexpr std::size_t unpaired = std::numeric_limits<std::size_t>::max();
+
+    struct Pair {
+        std::size_t first;
+        std::size_t second;
+        std::size_t slot = 0;        // Индекс псевдотела в укороченном наборе
+        T mass_first = T{0};
+        T mass_second = T{0};
+        Vector<T> position{};        // Относительное положение second - first
+        Vector<T> velocity{};
+    };
+
+    // Ускорение в точке target от массы mass в точке source
+    Vector<T> pull(const Vector<T>& source, const Vector<T>& target, T mass) const {
+        const Vector<T> r = source - target;
+        const T distance_squared = r.magnitude_squared();
+        if (distance_squared < T{1e-20}) {
+            return Vector<T>{};
+        }
+        return r * (g_ * mass / (distance_squared * sqrt(distance_squared)));
+    }
+
+    // Жадный выбор непересекающихся пар, начиная с самых тесных
+    void find_pairs(const std::vector<Body<T>>& bodies, T dt) {
+        candidates_.clear();
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            for (std::size_t j = i + 1; j < bodies.size(); ++j) {
+                const T mass = g_ * (bodies[i].mass() + bodies[j].mass());
+                if (!(mass > T{0})) {
+                    continue;
+                }
+                const T r = (bodies[j].position() - bodies[i].position()).magnitude();
+                const T free_fall = sqrt(r * r * r / mass);
+                if (free_fall < factor_ * dt) {
+                    candidates_.push_back({free_fall, i, j});
+                }
+            }
+        }
+        std::sort(candidates_.begin(), candidates_.end(),
+                  [](const Candidate& a, const Candidate& b) { return a.free_fall < b.free_fall; });
+
+        partner_.assign(bodies.size(), unpaired);
+        pairs_.clear();
+        for (const auto& candidate : candidates_) {
+            if (partner_[candidate.i] == unpaired && partner_[candidate.j] == unpaired) {
+                partner_[candidate.i] = candidate.j;
+                partner_[candidate.j] = candidate.i;
+                pairs_.push_back(Pair{candidate.i, candidate.j});
+            }
+        }
+    }
+
+    struct Candidate {
+        T free_fall;
+        std::size_t i;
+        std::size_t j;
+    };
+
+    T factor_ = T{20};
+    int steps_per_orbit_ = 256;
+    T g_ = T{1};
+
+    std::vector<Candidate> candidates_;
+    std::vector<std::size_t> partner_;
+    std::vector<std::size_t> slots_;
+    std::vector<Pair> pairs_;
+    std::vector<Body<T>> reduced_;
+    std::vector<Vector<T>> start_positions_;
+};
+
+} // namespace nbody
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "core/Body.hpp"
+#include "core/DoubleDouble.h"
+#include "core/SimdPack.hpp"
+#include "core/Vector.hpp"
+
+
+
+namespace nbody {
+
+// Политики точности прямого суммирования (параметр DirectSumForce и NewtonianSimulator)
+// Силы считаются в том же типе, что и состояние
+struct FullPrecision {};
+// Положения и скорости хранятся в T, разности координат берутся в T и округляются
+// до double, сумма O(N^2) считается в double
+struct MixedPrecision {};
+// То же, но силы пар считаются во float (вдвое шире SIMD), а сумма по телу набирается
+// с компенсацией Кэхэна и переводится в double. Расстояния между телами должны лежать
+// в диапазоне float: от 1e-10 до примерно 1e12. Пары ближе 1e-10 (r^2 < 1e-20) при любой
+// точности считаются совпадающими, и сила между ними не учитывается
+struct SinglePrecision {};
+
+// Ядро смешанной точности. Координата x = hi + lo раскладывается на две части double,
+// разность (hi_j - hi_i) + (lo_j - lo_i) совпадает с округлённой до double разностью в T
+// с точностью до пары ulp: близкие hi вычитаются точно, далёкие -- с относительной ошибкой ulp.
+// Силы пар считаются в S (double или float): ускорение тела i набирается пачками SimdPack
+// по телам j, остаток строки -- скалярно
+template <typename T, typename S = double>
+class MixedPrecisionForce {
+public:
+    static constexpr bool single = std::is_same_v<S, float>;
+    static constexpr std::size_t width = single ? float_simd_width : simd_width;
+    static constexpr std::size_t no_pair = std::numeric_limits<std::size_t>::max();
+
+    using Pack = SimdPack<S, width>;
+
+    MixedPrecisionForce() = default;
+
+    void set_g(T g) {
+        g_ = double(g);
+    }
+
+    void exclude_pair(std::size_t i, std::size_t j) {
+        excluded_i_ = std::min(i, j);
+        excluded_j_ = std::max(i, j);
+    }
+
+    void include_all_pairs() {
+        excluded_i_ = no_pair;
+        excluded_j_ = no_pair;
+    }
+
+    void set_track_potential(bool enabled) {
+        track_potential_ = enabled;
+    }
+
+    // Сумма m_i * m_j / r_ij по парам за последний compute (при set_track_potential)
+    double potential_sum() const {
+        return potential_sum_;
+    }
+
+    void compute(const std::vector<Body<T>>& bodies, std::vector<Vector<T>>& accelerations) {
+        load<3>(bodies.size(), [&](std::size_t i) -> const Vector<T>& { return bodies[i].position(); },
+                [&](std::size_t i) { return bodies[i].mass(); });
+        sum(accelerations);
+    }
+
+    template <std::size_t D>
+    void compute(const std::vector<Vector<T, D>>& positions, const std::vector<T>& masses,
+                 std::vector<Vector<T, D>>& accelerations) {
+        load<D>(positions.size(), [&](std::size_t i) -> const Vector<T, D>& { return positions[i]; },
+                [&](std::size_t i) { return masses[i]; });
+        sum(accelerations);
+    }
+
+private:
+    static double high_part(const T& x) {
+        if constexpr (std::is_same_v<T, DoubleDouble>) {
+            return x.hi;
+        } else {
+            return double(x);
+        }
+    }
+
+    static double low_part(const T& x) {
+        if constexpr (std::is_same_v<T, DoubleDouble>) {
+            return x.lo;
+        } else {
+            return 0.0;
+        }
+    }
+
+    template <std::size_t D, typename PositionOf, typename MassOf>
+    void load(std::size_t n, PositionOf position_of, MassOf mass_of) {
+        n_ = n;
+        for (std::size_t d = 0; d < D; ++d) {
+            hi_[d].resize(n);
+            lo_[d].resize(n);
+        }
+        masses_.resize(n);
+        if constexpr (single) {
+            for (std::size_t d = 0; d < D; ++d) {
+                separations_[d].resize(n);
+            }
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const Vector<T, D>& position = position_of(i);
+            for (std::size_t d = 0; d < D; ++d) {
+                hi_[d][i] = high_part(position[d]);
+                lo_[d][i] = low_part(position[d]);
+            }
+            masses_[i] = S(double(mass_of(i)));
+        }
+    }
+
+    template <std::size_t D>
+    void sum(std::vector<Vector<T, D>>& accelerations) {
+        accelerations.assign(n_, Vector<T, D>{});
+        potential_sum_ = 0.0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            // Исключённая пара убирается из строки обнулением массы партнёра
+            const std::size_t partner = i == excluded_i_ ? excluded_j_ : (i == excluded_j_ ? excluded_i_ : no_pair);
+            S hidden_mass = S{0};
+            if (partner < n_) {
+                std::swap(masses_[partner], hidden_mass);
+            }
+
+            double row_potential;
+            const std::array<double, D> acceleration = track_potential_ ? row<D, true>(i, row_potential)
+                                                                        : row<D, false>(i, row_potential);
+            for (std::size_t d = 0; d < D; ++d) {
+                accelerations[i][d] = T{acceleration[d] * g_};
+            }
+            // Каждая пара входит в строки обоих тел, отсюда половина в конце
+            if (track_potential_) {
+                potential_sum_ += double(masses_[i]) * row_potential;
+            }
+
+            if (partner < n_) {
+                std::swap(masses_[partner], hidden_mass);
+            }
+        }
+        potential_sum_ *= 0.5;
+    }
+
+    // Ускорение тела i без множителя G; при Potential в potential -- сумма m_j / r_ij по строке
+    template <std::size_t D, bool Potential>
+    std::array<double, D> row(std::size_t i, double& potential) {
+        const std::size_t full = n_ - n_ % width;
+
+        std::array<Pack, D> position_hi;
+        std::array<Pack, D> position_lo;
+        std::array<Pack, D> acceleration;
+        std::array<Pack, D> compensation;
+        Pack row_potential = Pack::broadcast(S{0});
+        Pack potential_compensation = Pack::broadcast(S{0});
+        for (std::size_t d = 0; d < D; ++d) {
+            position_hi[d] = Pack::broadcast(S(hi_[d][i]));
+            position_lo[d] = Pack::broadcast(S(lo_[d][i]));
+            acceleration[d] = Pack::broadcast(S{0});
+            compensation[d] = Pack::broadcast(S{0});
+        }
+
+        // Для float разности считаются в double заранее и округляются построчно
+        if constexpr (single) {
+            for (std::size_t d = 0; d < D; ++d) {
+                for (std::size_t j = 0; j < full; ++j) {
+                    separations_[d][j] = S(separation(d, i, j));
+                }
+            }
+        }
+
+        Pack near = Pack::broadcast(S{0});
+        const Pack one = Pack::broadcast(S{1});
+        for (std::size_t j = 0; j < full; j += width) {
+            std::array<Pack, D> r;
+            for (std::size_t d = 0; d < D; ++d) {
+                if constexpr (single) {
+                    r[d] = Pack::load(&separations_[d][j]);
+                } else {
+                    r[d] = (Pack::load(&hi_[d][j]) - position_hi[d]) + (Pack::load(&lo_[d][j]) - position_lo[d]);
+                }
+            }
+            Pack distance_squared = r[0] * r[0];
+            for (std::size_t d = 1; d < D; ++d) {
+                distance_squared = distance_squared + r[d] * r[d];
+            }
+
+            // Совпадающие тела (и само тело i) дают нулевой вклад
+            const Pack singular = Pack::less(distance_squared, S(1e-20));
+            near = near + singular;
+            distance_squared = distance_squared + singular;
+            const Pack scale = Pack::load(&masses_[j]) * (one - singular)
+                / (distance_squared * sqrt(distance_squared));
+            for (std::size_t d = 0; d < D; ++d) {
+                accumulate(acceleration[d], compensation[d], r[d] * scale);
+            }
+            if constexpr (Potential) {
+                accumulate(row_potential, potential_compensation, scale * distance_squared);
+            }
+        }
+
+        std::array<double, D> result{};
+        alignas(64) S lanes[width];
+        alignas(64) S lost[width];
+        for (std::size_t d = 0; d < D; ++d) {
+            acceleration[d].store(lanes);
+            compensation[d].store(lost);
+            for (std::size_t k = 0; k < width; ++k) {
+                result[d] += double(lanes[k]) - double(lost[k]);
+            }
+        }
+        potential = 0.0;
+        if constexpr (Potential) {
+            row_potential.store(lanes);
+            potential_compensation.store(lost);
+            for (std::size_t k = 0; k < width; ++k) {
+                potential += double(lanes[k]) - double(lost[k]);
+            }
+        }
+
+        // Кроме самого тела i в пачках нашлись совпадающие с ним тела
+        near.store(lanes);
+        S near_count = S{0};
+        for (std::size_t k = 0; k < width; ++k) {
+            near_count += lanes[k];
+        }
+        if (near_count > (i < full ? S{1} : S{0})) {
+            for (std::size_t j = 0; j < full; ++j) {
+                if (j != i && pair_distance_squared<D>(i, j) < S(1e-20)) {
+                    warn_singular(i, j);
+                    break;
+                }
+            }
+        }
+
+        for (std::size_t j = full; j < n_; ++j) {
+            if (j == i) {
+                continue;
+            }
+            const S r2 = pair_distance_squared<D>(i, j);
+            if (r2 < S(1e-20)) {
+                warn_singular(i, j);
+                continue;
+            }
+            const S scale = masses_[j] / (r2 * std::sqrt(r2));
+            for (std::size_t d = 0; d < D; ++d) {
+                result[d] += double(S(separation(d, i, j)) * scale);
+            }
+            if constexpr (Potential) {
+                potential += double(scale * r2);
+            }
+        }
+        return result;
+    }
+
+    // Прибавление пачки слагаемых; для float -- с компенсацией Кэхэна: compensation
+    // хранит потерянные младшие разряды
+    static void accumulate(Pack& sum, Pack& compensation, const Pack& term) {
+        if constexpr (single) {
+            const Pack y = term - compensation;
+            const Pack t = sum + y;
+            compensation = (t - sum) - y;
+            sum = t;
+        } else {
+            sum = sum + term;
+        }
+    }
+
+    double separation(std::size_t d, std::size_t i, std::size_t j) const {
+        return (hi_[d][j] - hi_[d][i]) + (lo_[d][j] - lo_[d][i]);
+    }
+
+    template <std::size_t D>
+    S pair_distance_squared(std::size_t i, std::size_t j) const {
+        S result = S{0};
+        for (std::size_t d = 0; d < D; ++d) {
+            const S r = S(separation(d, i, j));
+            result += r * r;
+        }
+        return result;
+    }
+
+    void warn_singular(std::size_t i, std::size_t j) const {
+        if (!singular_warned_) {
+            std::cerr << "MixedPrecisionForce -- WARNING: тела " << i << " и " << j
+                      << " совпадают, сила между ними не учитывается" << std::endl;
+            singular_warned_ = true;
+        }
+    }
+
+    double g_ = 1.0;
+    mutable bool singular_warned_ = false;
+    std::size_t excluded_i_ = no_pair;
+    std::size_t excluded_j_ = no_pair;
+    bool track_potential_ = false;
+    double potential_sum_ = 0.0;
+
+    std::size_t n_ = 0;
+    std::array<std::vector<double>, 3> hi_;
+    std::array<std::vector<double>, 3> lo_;
+    std::vector<S> masses_;
+    std::array<std::vector<S>, 3> separations_;
+};
+
+} // namespace nbody
@@ -1,27 +1,66 @@
 #pragma once
 
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "simulators/DirectSumForce.hpp"
+#include "simulators/Integrators.hpp"
+#include "simulators/KSRegularization.hpp"
 #include "simulators/Simulator.hpp"
-#include "systems/TwoBodySystem.hpp"
 
 
 
 namespace nbody {
 
-template <typename T>
+// Прямое суммирование сил; схема интегрирования задаётся политикой из Integrators.hpp.
+// При D = 2 силы и шаг считаются в плоских векторах, компонента z тел не используется.
+// Precision = MixedPrecision хранит состояние в T, а силы суммирует в double,
+// SinglePrecision считает силы пар во float
+template <typename T, typename Scheme = Leapfrog, std::size_t D = 3, typename Precision = FullPrecision>
 class NewtonianSimulator : public Simulator<T> {
 public:
     NewtonianSimulator() = default;
 
     void set_g(T g) override {
         g_ = g;
+        force_.set_g(g);
+    }
+
+    // KS-регуляризация тесных пар: пара, чьё время свободного падения меньше factor
+    // глобальных шагов, интегрируется отдельно, остальные тела сохраняют общий шаг
+    void set_regularization(bool enabled, T factor = T{20}) {
+        if (factor <= T{0}) {
+            throw std::invalid_argument("Regularization factor must be positive");
+        }
+        regularization_enabled_ = enabled;
+        regularization_.set_factor(factor);
+    }
+
+    bool regularization() const {
+        return regularization_enabled_;
+    }
+
+    // Число пар, регуляризованных на последнем шаге
+    std::size_t regularized_pairs() const {
+        return regularized_pairs_;
     }
     
     Vector<T> calculate_gravity_force(const Body<T>& body1, const Body<T>& body2) const {
         Vector<T> r = body2.position() - body1.position();
         T distance_squared = r.magnitude_squared();
         
-        // Избегаем деления на ноль
+        // Совпадающие тела: сила не определена
         if (distance_squared < T{1e-20}) {
+            if (!singular_warned_) {
+                const auto name = [this](const Body<T>& body) {
+                    return this->system_ ? this->system_->name(body) : std::string{};
+                };
+                std::cerr << "NewtonianSimulator -- WARNING: тела " << name(body1) << " и " << name(body2)
+                          << " совпадают, сила между ними не учитывается" << std::endl;
+                singular_warned_ = true;
+            }
             return Vector<T>{};
         }
         
@@ -30,60 +69,181 @@ public:
         return r.normalized() * force_magnitude;
     }
 
+    // Пакет из n шагов постоянной длины: один вызов symplectic_steps, в котором граничные
+    // толчки (или дрейфы) соседних шагов слиты, а плоское состояние упаковывается один раз.
+    // Регуляризация и всё, что исключает Simulator::batchable, требуют обработки после
+    // каждого шага -- тогда шаги выполняются по одному
+    std::size_t run_steps(std::size_t n) override {
+        if (!this->batchable(n) || regularization_enabled_) {
+            return Simulator<T>::run_steps(n);
+        }
+        this->before_step();
+        this->validation_failed_ = false;
+
+        const T dt = this->clip_dt(this->dt_);
+        advance_tracked(this->system_->bodies(), dt, n, true, this->compensated_ ? &compensation_ : nullptr);
+        this->step_totals_ready_ = true;
+        this->last_dt_ = dt;
+
+        const T elapsed = dt * T(double(n));
+        this->current_time_ += elapsed;
+        this->after_steps(dt, n);
+        return this->validate(n) ? n : 0;
+    }
+
     bool step() override {
         if (!this->system_) {
             return false;
         }
+        this->before_step();
         
-        auto& bodies = this->system_->bodies();
-        std::vector<Vector<T>> current_accelerations = calculate_accelerations(bodies);
-        
-        // v(t + dt/2) = v(t) + a(t)*dt/2
-        for (std::size_t i = 0; i < bodies.size(); ++i) {
-            Body<T>& body = bodies[i];
-            body.set_velocity(body.velocity() + current_accelerations[i] * (this->dt_ * T{0.5}));
+        auto& all_bodies = this->system_->bodies();
+        T dt = this->clip_dt(this->dt_);
+
+        // Тесные пары заменяются псевдотелами в центрах масс
+        const bool regularized = regularization_enabled_ && regularization_.pack(all_bodies, dt, g_);
+        regularized_pairs_ = regularized ? regularization_.pair_count() : 0;
+        auto& bodies = regularized ? regularization_.reduced() : all_bodies;
+
+        if (this->adaptive()) {
+            const T start_timescale = timescale(bodies);
+            dt = this->clip_dt(this->eta_ * start_timescale);
+
+            // Пробный шаг и пересчёт по среднему характерному времени начала и конца,
+            // чтобы выбор шага был симметричен по времени
+            if (this->time_symmetric_) {
+                save_state(bodies);
+                advance(bodies, dt);
+                const T end_timescale = timescale(bodies);
+                restore_state(bodies);
+                dt = this->clip_dt(this->eta_ * (start_timescale + end_timescale) * T{0.5});
+            }
+
+            if (!(dt > T{0})) {
+                std::cerr << "NewtonianSimulator -- WARNING: адаптивный шаг выродился в ноль" << std::endl;
+                return false;
+            }
         }
 
-        // x(t + dt) = x(t) + v(t + dt/2) * dt
-        for (std::size_t i = 0; i < bodies.size(); ++i) {
-            Body<T>& body = bodies[i];
-            body.set_position(body.position() + body.velocity() * this->dt_);
+        // Поправки компенсированного суммирования пар переходят к их псевдотелам и обратно
+        Compensation<Vector<T, D>>* compensation = nullptr;
+        if (this->compensated_) {
+            compensation_.resize(all_bodies.size());
+            compensation = &compensation_;
+            if (regularized) {
+                regularization_.pack_compensation(compensation_, reduced_compensation_);
+                compensation = &reduced_compensation_;
+            }
         }
-        
-        // a(t + dt) на основе новых позиций x(t + dt)
-        std::vector<Vector<T>> next_accelerations = calculate_accelerations(bodies);
-        
-        // v(t + dt) = v(t + dt/2) + a(t + dt)*dt/2
-        for (std::size_t i = 0; i < bodies.size(); ++i) {
-            Body<T>& body = bodies[i];
-            body.set_velocity(body.velocity() + next_accelerations[i] * (this->dt_ * T{0.5}));
+
+        advance_tracked(bodies, dt, 1, !regularized, compensation);
+        // Суммы по псевдотелам не совпадают с суммами по телам до распаковки пар
+        this->step_totals_ready_ = !regularized;
+        if (regularized) {
+            if (!regularization_.advance_pairs(dt)) {
+                return false;
+            }
+            regularization_.unpack(all_bodies);
+            if (compensation) {
+                regularization_.unpack_compensation(reduced_compensation_, compensation_);
+            }
         }
+        this->last_dt_ = dt;
         
-        auto* two_body_system = dynamic_cast<TwoBodySystem<T>*>(this->system_);
-        if (two_body_system) {
-            two_body_system->update_time(this->dt_);
-        }
+        this->after_step(dt);
         
         return true;
     }
     
 private:
-    std::vector<Vector<T>> calculate_accelerations(std::vector<Body<T>>& bodies) const {
-        std::vector<Vector<T>> accelerations(bodies.size(), Vector<T>{});
-        
-        for (std::size_t i = 0; i < bodies.size(); ++i) {
-            for (std::size_t j = i + 1; j < bodies.size(); ++j) {
-                Vector<T> force = calculate_gravity_force(bodies[i], bodies[j]);
+    // Если передан compensation, обновления компенсированные с поправками по номерам bodies
+    void advance(std::vector<Body<T>>& bodies, T dt, std::size_t steps = 1,
+                 Compensation<Vector<T, D>>* compensation = nullptr) {
+        if (compensation) {
+            compensation->resize(bodies.size());
+        }
+        if constexpr (D == 3) {
+            symplectic_steps<Scheme>(bodies, dt, steps, accelerations_,
+                [this](const std::vector<Body<T>>& current, std::vector<Vector<T>>& accelerations) {
+                    force_.compute(current, accelerations);
+                }, compensation, &this->step_totals_);
+        } else {
+            const std::size_t n = bodies.size();
+            masses_.resize(n);
+            planar_positions_.resize(n);
+            planar_velocities_.resize(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                masses_[i] = bodies[i].mass();
+                planar_positions_[i] = project<D>(bodies[i].position());
+                planar_velocities_[i] = project<D>(bodies[i].velocity());
+            }
+
+            symplectic_steps<Scheme>(planar_positions_, planar_velocities_, dt, steps, planar_accelerations_,
+                [this](const std::vector<Vector<T, D>>& positions, std::vector<Vector<T, D>>& accelerations) {
+                    force_.compute(positions, masses_, accelerations);
+                }, compensation);
 
-                accelerations[i] += force / bodies[i].mass();
-                accelerations[j] -= force / bodies[j].mass();
+            this->step_totals_ = BodyTotals<T>{};
+            for (std::size_t i = 0; i < n; ++i) {
+                bodies[i].set_position(project<3>(planar_positions_[i]));
+                bodies[i].set_velocity(project<3>(planar_velocities_[i]));
+                this->step_totals_.add(masses_[i], bodies[i].position(), bodies[i].velocity());
             }
         }
-        
-        return accelerations;
     }
-    
+
+    // Шаги с сохранением потенциальной энергии в System: последнее вычисление сил идёт
+    // на конечных положениях, если схема кончается толчком
+    void advance_tracked(std::vector<Body<T>>& bodies, T dt, std::size_t steps, bool trackable,
+                         Compensation<Vector<T, D>>* compensation) {
+        const bool track_potential = trackable && this->energy_tracking_
+            && DirectSumForce<T, Precision>::tracks_potential && Scheme::drift.back() == 0.0;
+        force_.set_track_potential(track_potential);
+        advance(bodies, dt, steps, compensation);
+        force_.set_track_potential(false);
+        if (track_potential) {
+            this->system_->store_potential_sum(force_.potential_sum());
+        }
+    }
+
+    T timescale(const std::vector<Body<T>>& bodies) {
+        if (this->criterion_ == TimeStepCriterion::AccelerationJerk) {
+            return force_.min_acceleration_jerk_time(bodies);
+        }
+        return force_.min_free_fall_time(bodies);
+    }
+
+    void save_state(const std::vector<Body<T>>& bodies) {
+        saved_positions_.resize(bodies.size());
+        saved_velocities_.resize(bodies.size());
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            saved_positions_[i] = bodies[i].position();
+            saved_velocities_[i] = bodies[i].velocity();
+        }
+    }
+
+    void restore_state(std::vector<Body<T>>& bodies) const {
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            bodies[i].set_position(saved_positions_[i]);
+            bodies[i].set_velocity(saved_velocities_[i]);
+        }
+    }
+
     T g_ = T{1};
+    DirectSumForce<T, Precision> force_;
+    PairRegularization<T> regularization_;
+    bool regularization_enabled_ = false;
+    std::size_t regularized_pairs_ = 0;
+    mutable bool singular_warned_ = false;
+    std::vector<Vector<T>> accelerations_;
+    std::vector<T> masses_;
+    std::vector<Vector<T, D>> planar_positions_;
+    std::vector<Vector<T, D>> planar_velocities_;
+    std::vector<Vector<T, D>> planar_accelerations_;
+    Compensation<Vector<T, D>> compensation_;           // Поправки при set_compensated
+    Compensation<Vector<T, D>> reduced_compensation_;   // То же для укороченного набора тел
+    std::vector<Vector<T>> saved_positions_;
+    std::vector<Vector<T>> saved_velocities_;
 };
 
 } // namespace nbody 
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "simulators/Integrators.hpp"
 #include "simulators/Simulator.hpp"
 #include "core/Body.hpp"
 #include "core/Vector.hpp"
@@ -13,7 +14,8 @@
 
 namespace nbody {
 
-template <typename T>
+// Силы считаются на сетке; схема интегрирования задаётся политикой из Integrators.hpp
+template <typename T, typename Scheme = SymplecticEuler>
 class ParticleMeshSimulator : public Simulator<T> {
 private:
     int grid_size_;
@@ -45,12 +47,17 @@ private:
     fftw_complex* fft_out_;
     fftw_plan plan_forward_;
     fftw_plan plan_backward_;
+    mutable std::vector<double> fft_in_copy_;                 // Для get_fft_in_data
+    mutable std::vector<std::complex<double>> fft_out_copy_;  // Для get_fft_out_data
     
     // Границы симуляции
     Vector<T> box_min_;
     Vector<T> box_max_;
     bool auto_box_size_;
 
+    std::vector<Vector<T>> accelerations_;
+    Compensation<Vector<T>> compensation_;   // Поправки при set_compensated
+
 public:
     explicit ParticleMeshSimulator(int grid_size = 64, double box_size = 0.0) 
         : grid_size_(grid_size), box_size_(T(box_size)), g_(T(1)),
@@ -111,24 +118,26 @@ public:
     Vector<T> get_box_min() const { return box_min_; }
     Vector<T> get_box_max() const { return box_max_; }
 
-    std::vector<double> get_fft_in_data() const {
-        std::vector<double> data(total_cells_);
+    // Копии буферов FFTW; буфер копии переиспользуется, ссылка действительна до следующего вызова
+    const std::vector<double>& get_fft_in_data() const {
+        fft_in_copy_.resize(total_cells_);
         for (int i = 0; i < total_cells_; ++i) {
-            data[i] = fft_in_[i];
+            fft_in_copy_[i] = fft_in_[i];
         }
-        return data;
+        return fft_in_copy_;
     }
     
-    std::vector<std::complex<double>> get_fft_out_data() const {
-        std::vector<std::complex<double>> data(fft_size_);
+    const std::vector<std::complex<double>>& get_fft_out_data() const {
+        fft_out_copy_.resize(fft_size_);
         for (int i = 0; i < fft_size_; ++i) {
-            data[i] = std::complex<double>(fft_out_[i][0], fft_out_[i][1]);
+            fft_out_copy_[i] = std::complex<double>(fft_out_[i][0], fft_out_[i][1]);
         }
-        return data;
+        return fft_out_copy_;
     }
 
     bool step() override {
         if (!this->system_) return false;
+        this->before_step();
         
         auto& bodies = this->system_->bodies();
         if (bodies.empty()) return false;
@@ -138,17 +147,21 @@ public:
             auto_box_size_ = false;
         }
 
-        out_of_bounds_count_ = 0;
-
-        mass_assignment(bodies);
-        solve_poisson_equation();
-        compute_forces();
-        integrate_equations_of_motion(bodies);
+        if (this->compensated_) {
+            compensation_.resize(bodies.size());
+        }
+        symplectic_step<Scheme>(bodies, this->dt_, accelerations_,
+            [this](const std::vector<Body<T>>& current, std::vector<Vector<T>>& accelerations) {
+                compute_accelerations(current, accelerations);
+            }, this->compensated_ ? &compensation_ : nullptr, &this->step_totals_);
+        this->step_totals_ready_ = true;
 
         if (adaptive_box_ && out_of_bounds_count_ > static_cast<int>(bodies.size()) / 4) {
             std::cerr << "ParticleMeshSimulator -- WARNING:Adapting box size due to " << out_of_bounds_count_ << " out-of-bounds particles" << std::endl;
             determine_simulation_box(bodies);
         }
+
+        this->after_step(this->dt_);
         
         return true;
     }
@@ -377,13 +390,18 @@ private:
         return force;
     }
 
-    void integrate_equations_of_motion(std::vector<Body<T>>& bodies) {
-        for (auto& body : bodies) {
-            Vector<T> force = interpolate_force_cic(body.position());
-            Vector<T> acceleration = force / body.mass();
+    // Пересчёт сетки по текущим положениям и интерполяция ускорений в точки тел
+    void compute_accelerations(const std::vector<Body<T>>& bodies, std::vector<Vector<T>>& accelerations) {
+        out_of_bounds_count_ = 0;
+
+        mass_assignment(bodies);
+        solve_poisson_equation();
+        compute_forces();
 
-            body.set_velocity(body.velocity() + acceleration * this->dt_);
-            body.set_position(body.position() + body.velocity() * this->dt_);
+        accelerations.resize(bodies.size());
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            Vector<T> force = interpolate_force_cic(bodies[i].position());
+            accelerations[i] = force / bodies[i].mass();
         }
     }
     
@@ -424,7 +442,7 @@ private:
                         grid_force = compute_force_at_grid_point(gi, gj, gk);
                     }
                     
-                    force += grid_force * weight;
+                    force.add_scaled(grid_force, weight);
                 }
             }
         }
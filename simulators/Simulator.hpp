@@ -1,14 +1,28 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
+#include "core/AllocationCounter.h"
+#include "core/ScratchArena.hpp"
+#include "simulators/CollisionMerger.hpp"
 #include "systems/System.hpp"
 
 
 
 namespace nbody {
 
+// Критерий выбора шага в адаптивном режиме
+enum class TimeStepCriterion {
+    Fixed,             // Постоянный шаг dt
+    FreeFall,          // Наименьшее по парам время свободного падения или пролёта
+    AccelerationJerk   // Наименьшее по телам отношение |a| / |da/dt|
+};
+
 template <typename T>
 class Simulator {
 public:
@@ -26,16 +40,137 @@ public:
             throw std::invalid_argument("Time step must be positive");
         }
         dt_ = dt;
+        last_dt_ = dt;
     }
 
     T dt() const {
         return dt_;
     }
 
+    // Адаптивный режим: шаг выбирается как eta * (характерное время системы)
+    // и не превышает dt. Поддерживается симуляторами с фиксированной схемой шага
+    void set_time_step_criterion(TimeStepCriterion criterion, T eta = T{0.02}) {
+        if (eta <= T{0}) {
+            throw std::invalid_argument("Time step factor must be positive");
+        }
+        criterion_ = criterion;
+        eta_ = eta;
+    }
+
+    TimeStepCriterion time_step_criterion() const {
+        return criterion_;
+    }
+
+    bool adaptive() const {
+        return criterion_ != TimeStepCriterion::Fixed;
+    }
+
+    // Симметризация шага по началу и концу (dt = eta * (tau_0 + tau_1) / 2),
+    // сохраняющая обратимость схемы
+    void set_time_symmetric(bool time_symmetric) {
+        time_symmetric_ = time_symmetric;
+    }
+
+    void set_min_dt(T min_dt) {
+        if (min_dt < T{0}) {
+            throw std::invalid_argument("Minimal time step must be non-negative");
+        }
+        min_dt_ = min_dt;
+    }
+
+    // Верхняя граница следующего шага, чтобы точно попасть в момент кадра; 0 -- без границы
+    void set_dt_limit(T limit) {
+        dt_limit_ = limit;
+    }
+
+    // Шаг, фактически сделанный на последнем step()
+    T last_dt() const {
+        return last_dt_;
+    }
+
     int steps_per_frame() const {
         return static_cast<int>(T{1e-2} / dt_);
     }
 
+    // Компенсированное (по Кэхэну) обновление положений и скоростей: ошибка округления
+    // не накапливается с числом шагов. Поддерживается NewtonianSimulator и ParticleMeshSimulator
+    void set_compensated(bool enabled) {
+        compensated_ = enabled;
+    }
+
+    bool compensated() const {
+        return compensated_;
+    }
+
+    // Сохранение в System суммы m_i * m_j / r_ij, набранной при вычислении сил: graph_value
+    // получает потенциальную энергию без отдельного прохода O(N^2). Поддерживается
+    // NewtonianSimulator и FixedNewtonianSimulator для схем, последний раз вычисляющих силы
+    // на конечных положениях шага (drift.back() == 0: Leapfrog, Yoshida4)
+    void set_energy_tracking(bool enabled) {
+        energy_tracking_ = enabled;
+    }
+
+    bool energy_tracking() const {
+        return energy_tracking_;
+    }
+
+    // Слияние столкнувшихся тел после каждого шага; радиусы берутся из Body::radius()
+    // и не меньше collision_merger().minimum_radius()
+    void set_collisions(bool enabled) {
+        collisions_ = enabled;
+    }
+
+    bool collisions() const {
+        return collisions_;
+    }
+
+    CollisionMerger<T>& collision_merger() {
+        return collision_merger_;
+    }
+
+    const CollisionMerger<T>& collision_merger() const {
+        return collision_merger_;
+    }
+
+    // Полная проверка системы (System::is_valid) выполняется раз в steps шагов; 0 -- никогда.
+    // На остальных шагах дрейф центра масс и импульса проверяется по суммам, набранным
+    // симулятором при обновлении скоростей (NewtonianSimulator, FixedNewtonianSimulator,
+    // ParticleMeshSimulator), за O(1)
+    void set_validation_interval(std::size_t steps) {
+        validation_interval_ = steps;
+        steps_since_validation_ = 0;
+    }
+
+    std::size_t validation_interval() const {
+        return validation_interval_;
+    }
+
+    // Проверка системы после steps шагов с учётом validation_interval
+    bool validate(std::size_t steps = 1) {
+        if (!system_) {
+            return false;
+        }
+        validation_failed_ = false;
+        if (validation_interval_ == 0) {
+            return true;
+        }
+        steps_since_validation_ += steps;
+        if (steps_since_validation_ >= validation_interval_) {
+            steps_since_validation_ = 0;
+            validation_failed_ = !system_->is_valid();
+        } else {
+            validation_failed_ = step_totals_ready_ && !system_->totals_valid(step_totals_);
+        }
+        return !validation_failed_;
+    }
+
+    // Последний run_steps остановлен проверкой системы, а не отказом шага
+    bool validation_failed() const {
+        return validation_failed_;
+    }
+
+    // Обратный вызов после каждого шага run_steps; отключает пакетное выполнение шагов.
+    // Для наблюдений с прореживанием без стирания типа -- run_observed и advance_observed
     void set_step_callback(StepCallback callback) {
         step_callback_ = callback;
     }
@@ -49,41 +184,221 @@ public:
     // Возвращает false, если симуляция не может продолжаться
     virtual bool step() = 0;
     
-    // Запуск симуляции на заданное количество шагов
-    // Возвращает фактическое количество выполненных шагов
-    std::size_t run(std::size_t max_steps) {
+    // Выполнение n шагов одним вызовом: после каждого шага продвигается current_time(),
+    // вызывается обратный вызов шага и проверка системы (validate). Симуляторы
+    // переопределяют метод, чтобы выполнять шаги пакетом без виртуального вызова step()
+    // на каждом шаге. Возвращает количество выполненных шагов; шаг, после которого
+    // система некорректна, не засчитывается. Пакет проверяется целиком после последнего
+    // шага: при ошибке он отклоняется и возвращается 0, хотя тела уже продвинуты
+    virtual std::size_t run_steps(std::size_t n) {
         if (!system_) {
             throw std::runtime_error("System not set");
         }
-        
+        validation_failed_ = false;
+
         std::size_t step_count = 0;
-        for (; step_count < max_steps; ++step_count) {
+        for (; step_count < n; ++step_count) {
             if (!step()) {
                 break;
             }
             
-            current_time_ += dt_;
+            current_time_ += last_dt_;
             
             if (step_callback_) {
                 step_callback_(*system_, current_time_);
             }
             
-            if (!system_->is_valid()) {
+            if (!validate()) {
                 break;
             }
         }
         
         return step_count;
     }
+
+    // Запуск симуляции на заданное количество шагов
+    // Возвращает фактическое количество выполненных шагов
+    std::size_t run(std::size_t max_steps) {
+        return run_steps(max_steps);
+    }
+
+    // Продвижение до момента t: при постоянном шаге целые шаги выполняются одним
+    // run_steps, остаток -- шагом, ограниченным set_dt_limit (NewtonianSimulator,
+    // FixedNewtonianSimulator; остальные симуляторы делают полный шаг dt).
+    // В адаптивном режиме шаги идут по одному до момента t
+    std::size_t advance_to(T t) {
+        if (!system_) {
+            throw std::runtime_error("System not set");
+        }
+
+        const T tolerance = dt_ * T{1e-9};
+        std::size_t step_count = 0;
+        if (!adaptive() && t - current_time_ > tolerance) {
+            const auto whole = static_cast<std::size_t>((t - current_time_) / dt_ + T{1e-9});
+            step_count = run_steps(whole);
+            if (step_count < whole) {
+                return step_count;
+            }
+        }
+
+        const T saved_limit = dt_limit_;
+        while (t - current_time_ > tolerance) {
+            dt_limit_ = t - current_time_;
+            if (run_steps(1) == 0) {
+                break;
+            }
+            ++step_count;
+        }
+        dt_limit_ = saved_limit;
+        return step_count;
+    }
+    
+    // Прогон n шагов с наблюдателями, известными на этапе компиляции: каждый observer
+    // вызывается как observer(system, time) после каждых every шагов и после последнего
+    // шага (every = 0 -- только после последнего). Вызовы наблюдателей встраиваются,
+    // без std::function; шаги между вызовами идут одним пакетом run_steps.
+    // Возвращает количество выполненных шагов
+    template <typename... Observers>
+    std::size_t run_observed(std::size_t n, std::size_t every, Observers&&... observers) {
+        if (!system_) {
+            throw std::runtime_error("System not set");
+        }
+
+        const std::size_t chunk = every == 0 ? n : every;
+        std::size_t step_count = 0;
+        while (step_count < n) {
+            const std::size_t requested = std::min(chunk, n - step_count);
+            const std::size_t done = run_steps(requested);
+            step_count += done;
+            if (done < requested) {
+                break;
+            }
+            (observers(std::as_const(*system_), current_time_), ...);
+        }
+        return step_count;
+    }
+
+    // Продвижение до момента t с вызовом наблюдателей в моменты, кратные interval
+    // от текущего времени, и в момент t (см. advance_to)
+    template <typename... Observers>
+    std::size_t advance_observed(T t, T interval, Observers&&... observers) {
+        if (!(interval > T{0})) {
+            throw std::invalid_argument("Observation interval must be positive");
+        }
+
+        const T start = current_time_;
+        std::size_t step_count = 0;
+        for (std::size_t k = 1; t - current_time_ > dt_ * T{1e-9}; ++k) {
+            const T target = std::min(t, start + interval * T(double(k)));
+            step_count += advance_to(target);
+            if (target - current_time_ > dt_ * T{1e-9}) {
+                break;
+            }
+            (observers(std::as_const(*system_), current_time_), ...);
+        }
+        return step_count;
+    }
     
     // Получение текущего времени симуляции
     T current_time() const { return current_time_; }
 
 protected:
+    // Шаг с учётом ограничений: не больше dt_ и dt_limit_, по возможности не меньше min_dt_
+    T clip_dt(T dt) const {
+        T result = std::max(std::min(dt, dt_), min_dt_);
+        if (dt_limit_ > T{0}) {
+            result = std::min(result, dt_limit_);
+        }
+        return result;
+    }
+
+    // Подготовка шага, вызывается в начале step() каждого симулятора: временные буферы
+    // шага возвращаются в scratch_
+    void before_step() {
+        scratch_.reset();
+        step_totals_ready_ = false;
+#ifdef NBODY_DEBUG_ALLOCATIONS
+        step_allocations_ = heap_allocation_count();
+        step_bodies_ = system_ ? system_->size() : 0;
+#endif
+    }
+
+    // Общая обработка после шага длительности dt, вызывается из step() каждого симулятора:
+    // слияние тел, затем уведомление системы и её наблюдателей (System::notify_step)
+    void after_step(T dt) {
+        if (collisions_ && system_) {
+            collision_merger_.merge(system_->bodies());
+        }
+        if (system_) {
+            system_->notify_step(dt);
+        }
+#ifdef NBODY_DEBUG_ALLOCATIONS
+        check_allocations();
+#endif
+    }
+
+    // Можно ли выполнить n шагов пакетом: после каждого шага не требуется ни выбор
+    // адаптивного шага, ни слияние тел, ни обратный вызов, ни наблюдатели системы
+    bool batchable(std::size_t n) const {
+        return system_ && n >= 2 && !adaptive() && !collisions_ && !step_callback_
+            && !system_->has_step_observers();
+    }
+
+    // Обработка после пакета из n шагов длительности dt (см. batchable): система
+    // уведомляется о каждом шаге, чтобы её on_step видел те же dt, что и при step()
+    void after_steps(T dt, std::size_t n) {
+        for (std::size_t k = 0; k < n; ++k) {
+            system_->notify_step(dt);
+        }
+#ifdef NBODY_DEBUG_ALLOCATIONS
+        check_allocations();
+#endif
+    }
+
+#ifdef NBODY_DEBUG_ALLOCATIONS
+    // В установившемся режиме (число тел не менялось, буферы уже выделены прошлыми
+    // шагами) шаг не должен обращаться к куче
+    void check_allocations() {
+        const std::size_t allocations = heap_allocation_count() - step_allocations_;
+        const bool same_bodies = step_bodies_ == previous_bodies_;
+        const bool steady = same_bodies && steady_steps_ >= warmup_steps;
+        steady_steps_ = same_bodies ? steady_steps_ + 1 : 0;
+        previous_bodies_ = step_bodies_;
+        if (steady && allocations > 0) {
+            throw std::logic_error("Simulator step allocated heap memory " + std::to_string(allocations)
+                                   + " times in steady state");
+        }
+    }
+#endif
+
     System<T>* system_ = nullptr;
     T dt_ = T{0.01};         // Шаг по времени
+    T last_dt_ = T{0.01};    // Последний сделанный шаг
+    T min_dt_ = T{0};
+    T dt_limit_ = T{0};
+    T eta_ = T{0.02};
+    TimeStepCriterion criterion_ = TimeStepCriterion::Fixed;
+    bool time_symmetric_ = true;
+    bool compensated_ = false;
+    bool collisions_ = false;
+    bool energy_tracking_ = false;
+    CollisionMerger<T> collision_merger_;
     T current_time_ = T{0};  // Текущее время симуляции
     StepCallback step_callback_ = nullptr;
+    ScratchArena<T, Vector<T>> scratch_;   // Временные буферы шага
+    BodyTotals<T> step_totals_;       // Суммы по телам на конце шага, если step_totals_ready_
+    bool step_totals_ready_ = false;
+    std::size_t validation_interval_ = 100;
+    std::size_t steps_since_validation_ = 0;
+    bool validation_failed_ = false;
+
+#ifdef NBODY_DEBUG_ALLOCATIONS
+    static constexpr std::size_t warmup_steps = 2;
+    std::size_t step_allocations_ = 0;
+    std::size_t step_bodies_ = 0;
+    std::size_t previous_bodies_ = 0;
+    std::size_t steady_steps_ = 0;
+#endif
 };
 
 } // namespace nbody 
\ No newline at end of file
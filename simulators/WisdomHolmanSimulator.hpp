@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "core/KeplerPropagator.hpp"
+#include "simulators/DirectSumForce.hpp"
+#include "simulators/Simulator.hpp"
+
+
+
+namespace nbody {
+
+// Смешанно-переменный симплектический интегратор Уиздома–Холмана
+// Wisdom J., Holman M. (1991) "Symplectic maps for the N-body problem"
+//
+// Гамильтониан делится на кеплеровскую часть (движение вокруг центрального тела),
+// которая решается аналитически в координатах Якоби, и взаимодействие тел между собой,
+// которое учитывается "толчками". Центральным считается тело с индексом 0.
+template <typename T>
+class WisdomHolmanSimulator : public Simulator<T> {
+public:
+    WisdomHolmanSimulator() {
+        // Взаимодействие центрального тела с первым полностью описывается дрейфом
+        force_.exclude_pair(0, 1);
+    }
+
+    void set_g(T g) override {
+        g_ = g;
+        force_.set_g(g);
+    }
+
+    // Порядок симплектического корректора: 0 (без корректора), 3 или 5
+    // Wisdom J., Holman M., Touma J. (1996) "Symplectic correctors"
+    void set_corrector_order(int order) {
+        if (order != 0 && order != 3 && order != 5) {
+            throw std::invalid_argument("Corrector order must be 0, 3 or 5");
+        }
+        corrector_order_ = order;
+        reset();
+    }
+
+    int corrector_order() const {
+        return corrector_order_;
+    }
+
+    // В безопасном режиме состояние на каждом шаге берётся из системы и записывается обратно
+    // с применением корректора. Без него внутреннее состояние хранится между шагами,
+    // в систему пишутся нескорректированные координаты, а точное состояние -- по synchronize()
+    void set_safe_mode(bool safe_mode) {
+        safe_mode_ = safe_mode;
+        reset();
+    }
+
+    bool safe_mode() const {
+        return safe_mode_;
+    }
+
+    // Сброс внутреннего состояния; нужен, если тела системы изменены извне
+    void reset() {
+        initialized_ = false;
+    }
+
+    // Запись в систему состояния с применённым корректором
+    void synchronize() {
+        if (!this->system_ || !initialized_) {
+            return;
+        }
+
+        // Нескорректированное состояние откладывается во временные буферы шага;
+        // вне шага они возвращаются арене при выходе
+        const auto scope = this->scratch_.scope();
+        auto& saved_pos = this->scratch_.template buffer<Vector<T>>(jacobi_pos_.size());
+        auto& saved_vel = this->scratch_.template buffer<Vector<T>>(jacobi_vel_.size());
+        std::copy(jacobi_pos_.begin(), jacobi_pos_.end(), saved_pos.begin());
+        std::copy(jacobi_vel_.begin(), jacobi_vel_.end(), saved_vel.begin());
+        apply_corrector(T{1});
+        store_to_system(this->system_->bodies());
+        std::copy(saved_pos.begin(), saved_pos.end(), jacobi_pos_.begin());
+        std::copy(saved_vel.begin(), saved_vel.end(), jacobi_vel_.begin());
+    }
+
+    bool step() override {
+        if (!this->system_) {
+            return false;
+        }
+        this->before_step();
+
+        auto& bodies = this->system_->bodies();
+        if (bodies.size() < 2) {
+            return false;
+        }
+
+        if (safe_mode_ || !initialized_ || jacobi_pos_.size() != bodies.size()) {
+            load_from_system(bodies);
+            apply_corrector(T{-1});
+            initialized_ = true;
+        }
+
+        const T half_dt = this->dt_ * T{0.5};
+        kepler_step(half_dt);
+        interaction_step(this->dt_);
+        kepler_step(half_dt);
+
+        if (safe_mode_) {
+            synchronize();
+        } else {
+            store_to_system(bodies);
+        }
+
+        this->after_step(this->dt_);
+
+        return true;
+    }
+
+private:
+    // Переход к координатам Якоби: каждое тело отсчитывается от центра масс предыдущих,
+    // нулевая компонента -- центр масс всей системы
+    void to_jacobi(const std::vector<Vector<T>>& inertial, std::vector<Vector<T>>& jacobi) const {
+        Vector<T> weighted = inertial[0] * masses_[0];
+        for (std::size_t i = 1; i < inertial.size(); ++i) {
+            jacobi[i] = inertial[i] - weighted / eta_[i - 1];
+            weighted.add_scaled(inertial[i], masses_[i]);
+        }
+        jacobi[0] = weighted / eta_.back();
+    }
+
+    void from_jacobi(const std::vector<Vector<T>>& jacobi, std::vector<Vector<T>>& inertial) const {
+        Vector<T> center = jacobi[0];
+        for (std::size_t i = jacobi.size() - 1; i > 0; --i) {
+            center.add_scaled(jacobi[i], -(masses_[i] / eta_[i]));
+            inertial[i] = jacobi[i] + center;
+        }
+        inertial[0] = center;
+    }
+
+    void load_from_system(const std::vector<Body<T>>& bodies) {
+        const std::size_t n = bodies.size();
+        masses_.resize(n);
+        eta_.resize(n);
+        positions_.resize(n);
+        velocities_.resize(n);
+        accelerations_.resize(n);
+        jacobi_pos_.resize(n);
+        jacobi_vel_.resize(n);
+        jacobi_acc_.resize(n);
+
+        T total_mass = T{0};
+        for (std::size_t i = 0; i < n; ++i) {
+            masses_[i] = bodies[i].mass();
+            total_mass += masses_[i];
+            eta_[i] = total_mass;
+            positions_[i] = bodies[i].position();
+            velocities_[i] = bodies[i].velocity();
+        }
+
+        to_jacobi(positions_, jacobi_pos_);
+        to_jacobi(velocities_, jacobi_vel_);
+    }
+
+    void store_to_system(std::vector<Body<T>>& bodies) {
+        from_jacobi(jacobi_pos_, positions_);
+        from_jacobi(jacobi_vel_, velocities_);
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            bodies[i].set_position(positions_[i]);
+            bodies[i].set_velocity(velocities_[i]);
+        }
+    }
+
+    // Кеплеровский дрейф: тело i движется вокруг массы eta_i, центр масс -- равномерно
+    void kepler_step(T dt) {
+        jacobi_pos_[0].add_scaled(jacobi_vel_[0], dt);
+
+        const std::size_t n = jacobi_pos_.size();
+        orbits_.resize(n - 1);
+        for (std::size_t i = 1; i < n; ++i) {
+            orbits_.set(i - 1, jacobi_pos_[i], jacobi_vel_[i], g_ * eta_[i]);
+        }
+        propagator_.propagate(orbits_, dt);
+        for (std::size_t i = 1; i < n; ++i) {
+            jacobi_pos_[i] = orbits_.position(i - 1);
+            jacobi_vel_[i] = orbits_.velocity(i - 1);
+        }
+    }
+
+    // Толчок от взаимодействия: полные ускорения без пары (0, 1), переведённые в координаты Якоби,
+    // за вычетом кеплеровской части, уже учтённой в дрейфе
+    void interaction_step(T dt) {
+        from_jacobi(jacobi_pos_, positions_);
+        force_.compute(positions_, masses_, accelerations_);
+        to_jacobi(accelerations_, jacobi_acc_);
+
+        for (std::size_t i = 1; i < jacobi_pos_.size(); ++i) {
+            Vector<T> acceleration = jacobi_acc_[i];
+            if (i > 1) {
+                const T r2 = jacobi_pos_[i].magnitude_squared();
+                acceleration.add_scaled(jacobi_pos_[i], g_ * eta_[i] / (r2 * sqrt(r2)));
+            }
+            jacobi_vel_[i].add_scaled(acceleration, dt);
+        }
+    }
+
+    // Корректор строится из отображений Z(a, b) = K(a) I(-b) K(-2a) I(b) K(a),
+    // sign = 1 -- прямой корректор, sign = -1 -- обратный. В первом порядке по массам
+    // планет пара Z(a, b) Z(-a, -b) даёт 4b (a L + a^3 L^3 / 6 + ...) I, L -- коммутатор
+    // с K; a и b -- в единицах dt, a_k = k * sqrt(7/40) как у Wisdom, Holman, Touma (1996) и в REBOUND (whfast.c).
+    // 3-й порядок: b = -1/(96 a_1) обнуляет член eps*dt^2; 5-й порядок: b = -5/(288 a_1)
+    // при a_1 и 1/(288 a_1) при a_2 обнуляют члены eps*dt^2 и eps*dt^4.
+    // Наклон ошибки энергии по dt проверяет benchmarks/wh_corrector.cpp
+    void apply_corrector(T sign) {
+        if (corrector_order_ == 0) {
+            return;
+        }
+
+        const T dt = this->dt_;
+        const T a1 = T{corrector_a1} * dt;
+        const T a2 = T{2} * a1;
+        if (corrector_order_ == 3) {
+            corrector_z(a1, sign * T{corrector_b31} * dt);
+            corrector_z(-a1, -sign * T{corrector_b31} * dt);
+        } else {
+            corrector_z(-a2, sign * T{corrector_b51} * dt);
+            corrector_z(-a1, sign * T{corrector_b52} * dt);
+            corrector_z(a1, -sign * T{corrector_b52} * dt);
+            corrector_z(a2, -sign * T{corrector_b51} * dt);
+        }
+    }
+
+    void corrector_z(T a, T b) {
+        kepler_step(a);
+        interaction_step(-b);
+        kepler_step(T{-2} * a);
+        interaction_step(b);
+        kepler_step(a);
+    }
+
+    static constexpr double corrector_a1 = 0.41833001326703777399;    // sqrt(7/40)
+    static constexpr double corrector_b31 = -0.024900596027799867499;  // -1/(96 a_1)
+    static constexpr double corrector_b51 = -0.0083001986759332891665; // -1/(288 a_1)
+    static constexpr double corrector_b52 = 0.041500993379666445832;   // 5/(288 a_1)
+
+    T g_ = T{1};
+    int corrector_order_ = 0;
+    bool safe_mode_ = true;
+    bool initialized_ = false;
+
+    std::vector<T> masses_;
+    std::vector<T> eta_;                     // Накопленные массы тел 0..i
+    std::vector<Vector<T>> positions_;
+    std::vector<Vector<T>> velocities_;
+    std::vector<Vector<T>> accelerations_;
+    std::vector<Vector<T>> jacobi_pos_;
+    std::vector<Vector<T>> jacobi_vel_;
+    std::vector<Vector<T>> jacobi_acc_;
+
+    DirectSumForce<T> force_;
+    KeplerOrbits<T> orbits_;
+    KeplerPropagator<T> propagator_;
+};
+
+} // namespace nbody
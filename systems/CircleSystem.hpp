@@ -12,6 +12,9 @@ namespace nbody {
 template <typename T>
 class CircleSystem : public System<T> {
 public:
+    // Движение плоское (z = 0)
+    static constexpr std::size_t dimensions = 2;
+
     CircleSystem() {}
     
     void generate() override {
@@ -33,26 +36,17 @@ public:
             T vy = orbit_velocity * cos(angle);
             Vector<T> velocity(vx, vy, T{0});
             
-            this->add_body(Body<T>(mass, position, velocity, "Body " + std::to_string(i+1)));
+            this->add_body(Body<T>(mass, position, velocity), "Body " + std::to_string(i+1));
         }
     }
     
 
     bool is_valid() const override {
-        Vector<T> center_of_mass;
-        Vector<T> total_momentum;
-        T total_mass = T{0};
-        
-        for (const auto& body : this->bodies()) {
-            center_of_mass += body.position() * body.mass();
-            total_momentum += body.velocity() * body.mass();
-            total_mass += body.mass();
-        }
-        
-        if (total_mass > T{0}) {
-            center_of_mass = center_of_mass / total_mass;
-        }
-        
+        return this->totals_valid(this->totals());
+    }
+
+    bool totals_valid(const BodyTotals<T>& totals) const override {
+        const Vector<T> center_of_mass = totals.center_of_mass();
         const T epsilon = T{5e-1};
         
         // центр масс близок к нулю
@@ -62,8 +56,8 @@ public:
         }
         
         // суммарный импульс близок к нулю
-        if (total_momentum.magnitude() > epsilon) {
-            std::cerr << "ERROR: импульс отклонился: " << total_momentum << std::endl;
+        if (totals.momentum.magnitude() > epsilon) {
+            std::cerr << "ERROR: импульс отклонился: " << totals.momentum << std::endl;
             return false;
         }
         
@@ -71,25 +65,8 @@ public:
     }
 
     T graph_value() const override {
-        T total_energy = T{0};
         const T G = T{1};
-        
-        for (size_t i = 0; i < this->bodies().size(); ++i) {
-            const auto& body_i = this->bodies()[i];
-            T kinetic_energy = T{0.5} * body_i.mass() * body_i.velocity().magnitude_squared();
-            total_energy += kinetic_energy;
-            
-            for (size_t j = i + 1; j < this->bodies().size(); ++j) {
-                const auto& body_j = this->bodies()[j];
-                T distance = (body_i.position() - body_j.position()).magnitude();
-                if (distance > T{0}) {
-                    T potential_energy = -G * body_i.mass() * body_j.mass() / distance;
-                    total_energy += potential_energy;
-                }
-            }
-        }
-        
-        return total_energy;
+        return this->kinetic_energy() - G * this->potential_sum();
     }
     
 private:
@@ -6,8 +6,10 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "core/KeplerPropagator.hpp"
 #include "systems/System.hpp"
 
 
@@ -33,7 +35,7 @@ public:
         const T AU = T{1.496e11};
         const T PI = T{3.14159265358979323846};
 
-        this->add_body(Body<T>(M_SUN, Vector<T>(T{0}, T{0}, T{0}), Vector<T>(T{0}, T{0}, T{0}), "Sun"));
+        this->add_body(Body<T>(M_SUN, Vector<T>(T{0}, T{0}, T{0}), Vector<T>(T{0}, T{0}, T{0})), "Sun");
         
         add_planet("Mercury", T{3.30e23}, T{0.387}, T{0.2056}, T{7.00}, T{29.12}, T{48.33}, T{0.0}, G, M_SUN, AU, PI);
         add_planet("Venus", T{4.87e24}, T{0.723}, T{0.0068}, T{3.39}, T{54.88}, T{76.68}, T{0.0}, G, M_SUN, AU, PI);
@@ -51,6 +53,7 @@ public:
         add_planet("Eris", T{1.66e22}, T{67.8}, T{0.4361}, T{44.04}, T{35.95}, T{150.98}, T{0.0}, G, M_SUN, AU, PI);
         add_planet("Haumea", T{4.01e21}, T{43.1}, T{0.1913}, T{28.19}, T{121.79}, T{239.08}, T{0.0}, G, M_SUN, AU, PI);
         add_planet("Makemake", T{3.1e21}, T{45.8}, T{0.1610}, T{29.01}, T{79.36}, T{297.24}, T{0.0}, G, M_SUN, AU, PI);
+        flush_pending_orbits();
 
         std::vector<std::string> main_belt_files = {"main_belt_test.csv"};
         std::vector<std::string> kuiper_belt_files = {"kuiper_belt_test.csv"};
@@ -90,6 +93,7 @@ public:
             }
 
             FileLoadResult file_result = process_file(file, filename);
+            flush_pending_orbits();
             result.total_loaded += file_result.loaded;
             result.total_skipped += file_result.skipped;
             result.mass_sum += file_result.mass_sum;
@@ -232,93 +236,38 @@ private:
         const T AU = T{1.496e11};
         const T PI = T{3.14159265358979323846};
         
-        T i = i_deg * PI / T{180};
-        T omega = omega_deg * PI / T{180};
-        T Omega = Omega_deg * PI / T{180};
-        T ma = ma_deg * PI / T{180};
-        T a_m = a * AU;
-        
-        T E = ma;
-        for (int iter = 0; iter < 10000; ++iter) {
-            T delta_E = (E - e * sin(E) - ma) / (T{1} - e * cos(E));
-            E -= delta_E;
-            if (abs(delta_E) < T{1e-10}) break;
-        }
-        
-        T true_anomaly = T{2} * atan2(T(sqrt(T{1} + e) * sin(E / T{2})), 
-                                      T(sqrt(T{1} - e) * cos(E / T{2})));
-        T r = a_m * (T{1} - e * cos(E));
-        
-        T x_orb = r * cos(true_anomaly);
-        T y_orb = r * sin(true_anomaly);
-        
-        T x = (cos(omega) * cos(Omega) - sin(omega) * sin(Omega) * cos(i)) * x_orb +
-              (-sin(omega) * cos(Omega) - cos(omega) * sin(Omega) * cos(i)) * y_orb;
-        T y = (cos(omega) * sin(Omega) + sin(omega) * cos(Omega) * cos(i)) * x_orb +
-              (-sin(omega) * sin(Omega) + cos(omega) * cos(Omega) * cos(i)) * y_orb;
-        T z = (sin(omega) * sin(i)) * x_orb + (cos(omega) * sin(i)) * y_orb;
-        
-        T mu = G * M_SUN;
-        T p = a_m * (T{1} - e * e);
-        T v_x_orb = -sqrt(mu / p) * sin(true_anomaly);
-        T v_y_orb = sqrt(mu / p) * (e + cos(true_anomaly));
-        
-        T vx = (cos(omega) * cos(Omega) - sin(omega) * sin(Omega) * cos(i)) * v_x_orb +
-               (-sin(omega) * cos(Omega) - cos(omega) * sin(Omega) * cos(i)) * v_y_orb;
-        T vy = (cos(omega) * sin(Omega) + sin(omega) * cos(Omega) * cos(i)) * v_x_orb +
-               (-sin(omega) * sin(Omega) + cos(omega) * cos(Omega) * cos(i)) * v_y_orb;
-        T vz = (sin(omega) * sin(i)) * v_x_orb + (cos(omega) * sin(i)) * v_y_orb;
-        
-        this->add_body(Body<T>(mass, Vector<T>(x, y, z), Vector<T>(vx, vy, vz), name));
+        queue_orbit(name, mass, a * AU, e, i_deg * PI / T{180}, omega_deg * PI / T{180},
+                    Omega_deg * PI / T{180}, ma_deg * PI / T{180}, G * M_SUN);
     }
 
     void add_planet(const std::string& name, T mass, T a_au, T e, T i_deg, T omega_deg, T Omega_deg, T ma_deg,
                    T G, T M_SUN, T AU, T PI) {
-        // Преобразуем углы в радианы
-        T i = i_deg * PI / T{180.0};
-        T omega = omega_deg * PI / T{180.0};  
-        T Omega = Omega_deg * PI / T{180.0};
-        T ma = ma_deg * PI / T{180.0};
-        T a = a_au * AU;
-        
-        // Решаем уравнение Кеплера для эксцентрической аномалии
-        T E = ma;
-        for (int iter = 0; iter < 10000; ++iter) {
-            T delta_E = (E - e * sin(E) - ma) / (T{1.0} - e * cos(E));
-            E -= delta_E;
-            if (abs(delta_E) < T{1e-10}) break;
+        queue_orbit(name, mass, a_au * AU, e, i_deg * PI / T{180.0}, omega_deg * PI / T{180.0},
+                    Omega_deg * PI / T{180.0}, ma_deg * PI / T{180.0}, G * M_SUN);
+    }
+
+    // Тело ставится в перицентр и откладывается; до заданной средней аномалии
+    // все отложенные орбиты доводятся одним пакетным вызовом в flush_pending_orbits()
+    void queue_orbit(const std::string& name, T mass, T a, T e, T i, T omega, T Omega, T ma, T mu) {
+        Vector<T> position, velocity;
+        KeplerPropagator<T>::pericenter_state(mu, a, e, i, omega, Omega, position, velocity);
+
+        pending_orbits_.push_back(position, velocity, mu);
+        pending_times_.push_back(KeplerPropagator<T>::time_since_pericenter(mu, a, ma));
+        pending_bodies_.emplace_back(name, mass);
+    }
+
+    void flush_pending_orbits() {
+        propagator_.propagate(pending_orbits_, pending_times_);
+
+        for (std::size_t k = 0; k < pending_bodies_.size(); ++k) {
+            this->add_body(Body<T>(pending_bodies_[k].second, pending_orbits_.position(k),
+                                   pending_orbits_.velocity(k)), pending_bodies_[k].first);
         }
-        
-        // Вычисляем истинную аномалию
-        T true_anomaly = T{2.0} * atan2(T(sqrt(T{1.0} + e) * sin(E / T{2.0})), 
-                                        T(sqrt(T{1.0} - e) * cos(E / T{2.0})));
-        T r = a * (T{1.0} - e * cos(E));
-        
-        // Позиция в орбитальной плоскости
-        T x_orb = r * cos(true_anomaly);
-        T y_orb = r * sin(true_anomaly);
-        
-        // Поворот в экваториальную систему координат
-        T x = (cos(omega) * cos(Omega) - sin(omega) * sin(Omega) * cos(i)) * x_orb +
-              (-sin(omega) * cos(Omega) - cos(omega) * sin(Omega) * cos(i)) * y_orb;
-        T y = (cos(omega) * sin(Omega) + sin(omega) * cos(Omega) * cos(i)) * x_orb +
-              (-sin(omega) * sin(Omega) + cos(omega) * cos(Omega) * cos(i)) * y_orb;
-        T z = (sin(omega) * sin(i)) * x_orb + (cos(omega) * sin(i)) * y_orb;
-        
-        // Скорости в орбитальной плоскости
-        T mu = G * M_SUN;
-        T p = a * (T{1.0} - e * e);
-        T v_x_orb = -sqrt(mu / p) * sin(true_anomaly);
-        T v_y_orb = sqrt(mu / p) * (e + cos(true_anomaly));
-        
-        // Поворот скоростей в экваториальную систему
-        T vx = (cos(omega) * cos(Omega) - sin(omega) * sin(Omega) * cos(i)) * v_x_orb +
-               (-sin(omega) * cos(Omega) - cos(omega) * sin(Omega) * cos(i)) * v_y_orb;
-        T vy = (cos(omega) * sin(Omega) + sin(omega) * cos(Omega) * cos(i)) * v_x_orb +
-               (-sin(omega) * sin(Omega) + cos(omega) * cos(Omega) * cos(i)) * v_y_orb;
-        T vz = (sin(omega) * sin(i)) * v_x_orb + (cos(omega) * sin(i)) * v_y_orb;
-        
-        this->add_body(Body<T>(mass, Vector<T>(x, y, z), Vector<T>(vx, vy, vz), name));
+
+        pending_orbits_.clear();
+        pending_times_.clear();
+        pending_bodies_.clear();
     }
     
     void shift_to_barycenter() {
@@ -347,27 +296,13 @@ private:
     
     T compute_total_energy() const {
         const T G = T{6.67430e-11};
-        T kinetic = T{0};
-        T potential = T{0};
-
-        for (const auto& body : this->bodies()) {
-            T v_squared = body.velocity().magnitude_squared();
-            kinetic += T{0.5} * body.mass() * v_squared;
-        }
-
-        for (size_t i = 0; i < this->bodies().size(); ++i) {
-            for (size_t j = i + 1; j < this->bodies().size(); ++j) {
-                const auto& body_i = this->bodies()[i];
-                const auto& body_j = this->bodies()[j];
-                T distance = (body_i.position() - body_j.position()).magnitude();
-                if (distance > T{0}) {
-                    potential -= G * body_i.mass() * body_j.mass() / distance;
-                }
-            }
-        }
-        
-        return kinetic + potential;
+        return this->kinetic_energy() - G * this->potential_sum();
     }
+
+    KeplerPropagator<T> propagator_;
+    KeplerOrbits<T> pending_orbits_;
+    std::vector<T> pending_times_;
+    std::vector<std::pair<std::string, T>> pending_bodies_;  // Имя и масса отложенных тел
 };
 
 } // namespace nbody 
\ No newline at end of file
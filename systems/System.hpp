@@ -1,15 +1,26 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "core/Body.hpp"
+#include "core/PotentialTree.hpp"
 
 
 
 namespace nbody {
 
+// Способ вычисления потенциальной энергии в System::potential_sum
+enum class PotentialMethod {
+    Exact,  // Сумма по всем парам, O(N^2)
+    Tree    // Обход октодерева (core/PotentialTree.hpp), O(N log N)
+};
+
 template <typename T>
 class System {
 public:
@@ -17,23 +28,157 @@ public:
     virtual ~System() = default;
 
     const std::vector<Body<T>>& bodies() const { return bodies_; }
-    std::vector<Body<T>>& bodies() { return bodies_; }
+
+    // Изменяемый доступ считается изменением состояния: сохранённая потенциальная
+    // энергия перестаёт действовать (см. store_potential_sum)
+    std::vector<Body<T>>& bodies() {
+        ++version_;
+        return bodies_;
+    }
 
     void add_body(const Body<T>& body) {
+        ++version_;
+        bodies_.push_back(body);
+    }
+
+    // Добавление тела с именем: имя заносится в таблицу, тело хранит его номер
+    void add_body(Body<T> body, const std::string& name) {
+        body.set_name_id(intern(name));
+        ++version_;
         bodies_.push_back(body);
     }
 
+    // Номер имени в таблице; одинаковые имена получают один номер
+    std::uint32_t intern(const std::string& name) {
+        if (name.empty()) {
+            return 0;
+        }
+        const auto [it, inserted] = name_ids_.try_emplace(name, std::uint32_t(names_.size()));
+        if (inserted) {
+            names_.push_back(name);
+        }
+        return it->second;
+    }
+
+    const std::string& name(std::uint32_t name_id) const {
+        return name_id < names_.size() ? names_[name_id] : names_.front();
+    }
+
+    const std::string& name(const Body<T>& body) const {
+        return name(body.name_id());
+    }
+
+    // Наблюдатель шага: получает систему и длительность сделанного шага
+    using StepObserver = std::function<void(System<T>&, T)>;
+
+    // Регистрируется один раз; вызывается после каждого шага любого симулятора
+    void add_step_observer(StepObserver observer) {
+        step_observers_.push_back(std::move(observer));
+    }
+
+    bool has_step_observers() const {
+        return !step_observers_.empty();
+    }
+
+    // Вызывается симулятором в конце шага: время системы продвигается на dt,
+    // затем вызываются on_step подкласса и наблюдатели. Сохранённая симулятором потенциальная
+    // энергия остаётся действительной: наблюдатель, двигающий тела, получает их через bodies()
+    void notify_step(T dt) {
+        time_ += dt;
+        on_step(dt);
+        for (auto& observer : step_observers_) {
+            observer(*this, dt);
+        }
+    }
+
+    // Время, пройденное системой с последнего clear()
+    T time() const {
+        return time_;
+    }
+
     void clear() {
+        time_ = T{0};
         bodies_.clear();
+        names_.resize(1);
+        name_ids_.clear();
+        ++version_;
+    }
+
+    // Приближённый потенциал для больших N: opening_angle задаёт точность обхода дерева
+    // (зависимость ошибки от него -- в core/PotentialTree.hpp; при 0.5 около 1e-5)
+    void set_potential_method(PotentialMethod method, T opening_angle = T{0.5}) {
+        if (opening_angle < T{0}) {
+            throw std::invalid_argument("Opening angle must be non-negative");
+        }
+        potential_method_ = method;
+        opening_angle_ = opening_angle;
+    }
+
+    PotentialMethod potential_method() const {
+        return potential_method_;
+    }
+
+    // Сумма m_i * m_j / r_ij по парам тел (потенциальная энергия -- это -G * сумма).
+    // Если симулятор сохранил сумму, набранную при вычислении сил для текущих положений
+    // и масс (store_potential_sum), и тела с тех пор не менялись, она берётся готовой,
+    // иначе считается выбранным методом
+    T potential_sum() const {
+        if (potential_sum_valid_ && potential_sum_version_ == version_) {
+            return potential_sum_;
+        }
+        if (potential_method_ == PotentialMethod::Tree) {
+            return potential_tree_.potential_sum(bodies_, opening_angle_);
+        }
+
+        T sum = T{0};
+        for (std::size_t i = 0; i < bodies_.size(); ++i) {
+            for (std::size_t j = i + 1; j < bodies_.size(); ++j) {
+                const T distance = (bodies_[i].position() - bodies_[j].position()).magnitude();
+                if (distance > T{0}) {
+                    sum += bodies_[i].mass() * bodies_[j].mass() / distance;
+                }
+            }
+        }
+        return sum;
+    }
+
+    // Сумма относится к состоянию тел на момент вызова: симулятор сохраняет её после
+    // записи положений в тела и не меняет их до конца шага через ранее взятую ссылку
+    void store_potential_sum(T sum) {
+        potential_sum_ = sum;
+        potential_sum_version_ = version_;
+        potential_sum_valid_ = true;
+    }
+
+    T kinetic_energy() const {
+        T energy = T{0};
+        for (const auto& body : bodies_) {
+            energy += T{0.5} * body.mass() * body.velocity().magnitude_squared();
+        }
+        return energy;
     }
 
     std::size_t size() const {
         return bodies_.size();
     }
     
+    // Масса, sum m * x и импульс по всем телам, O(N)
+    BodyTotals<T> totals() const {
+        BodyTotals<T> result;
+        for (const auto& body : bodies_) {
+            result.add(body.mass(), body.position(), body.velocity());
+        }
+        return result;
+    }
+
     // Проверка корректности состояния системы
     // Можно переопределить в подклассах для дополнительных проверок
     virtual bool is_valid() const { return true; }
+
+    // Проверка по суммам по телам (дрейф центра масс и импульса) без прохода по телам:
+    // симуляторы набирают суммы во время шага (см. Simulator::validate). Системы,
+    // проверяющие суммы, переопределяют и is_valid как totals_valid(totals())
+    virtual bool totals_valid(const BodyTotals<T>&) const { return true; }
     
     // Генерация начального состояния системы
     // Должна быть определена в подклассах
@@ -42,7 +187,27 @@ public:
     virtual T graph_value() const = 0;
     
 protected:
+    // Реакция подкласса на сделанный шаг (например, собственные часы системы)
+    virtual void on_step(T) {}
+
+private:
+    // Тела меняются только через bodies(), add_body и clear, отмечающие новую версию
     std::vector<Body<T>> bodies_;
+    std::uint64_t version_ = 0;
+
+    T time_ = T{0};
+    std::vector<StepObserver> step_observers_;
+
+    T potential_sum_ = T{0};
+    std::uint64_t potential_sum_version_ = 0;  // Версия тел, для которой сохранена сумма
+    bool potential_sum_valid_ = false;
+    PotentialMethod potential_method_ = PotentialMethod::Exact;
+    T opening_angle_ = T{0.5};
+    mutable PotentialTree<T> potential_tree_;  // Буферы дерева переиспользуются между вызовами
+
+    // Имена тел; номер 0 -- пустое имя
+    std::vector<std::string> names_{std::string{}};
+    std::unordered_map<std::string, std::uint32_t> name_ids_;
 };
 
 } // namespace nbody 
\ No newline at end of file
@@ -11,6 +11,11 @@ namespace nbody {
 template <typename T>
 class ThreeBodySystem : public System<T> {
 public:
+    // Число тел известно на этапе компиляции (см. FixedNewtonianSimulator)
+    static constexpr std::size_t fixed_size = 3;
+    // Движение плоское (z = 0)
+    static constexpr std::size_t dimensions = 2;
+
     ThreeBodySystem() = default;
     
     void generate() override {
@@ -30,35 +35,22 @@ public:
         Vector<T> vel1 = -vel3 / T{2};
         Vector<T> vel2 = -vel3 / T{2};
 
-        this->add_body(Body<T>(mass, pos1, vel1, "Body 1"));
-        this->add_body(Body<T>(mass, pos2, vel2, "Body 2"));
-        this->add_body(Body<T>(mass, pos3, vel3, "Body 3"));
+        this->add_body(Body<T>(mass, pos1, vel1), "Body 1");
+        this->add_body(Body<T>(mass, pos2, vel2), "Body 2");
+        this->add_body(Body<T>(mass, pos3, vel3), "Body 3");
     }
     
+
     bool is_valid() const override {
-        if (!System<T>::is_valid()) {
-            return false;
-        }
+        return this->totals_valid(this->totals());
+    }
 
-        Vector<T> center_of_mass;
-        Vector<T> total_momentum;
-        T total_mass = T{0};
-        
-        for (const auto& body : this->bodies()) {
-            center_of_mass += body.position() * body.mass();
-            total_momentum += body.velocity() * body.mass();
-            total_mass += body.mass();
-        }
-        
-        if (total_mass > T{0}) {
-            center_of_mass = center_of_mass / total_mass;
-        }
-        
+    bool totals_valid(const BodyTotals<T>& totals) const override {
         const T epsilon = T{1e-1};
         
         // суммарный импульс близок к нулю
-        if (total_momentum.magnitude() > epsilon) {
-            std::cerr << "Ошибка: импульс отклонился: " << total_momentum << std::endl;
+        if (totals.momentum.magnitude() > epsilon) {
+            std::cerr << "Ошибка: импульс отклонился: " << totals.momentum << std::endl;
             return false;
         }
         
@@ -66,25 +58,8 @@ public:
     }
     
     T graph_value() const override {
-        T total_energy = T{0};
         const T G = T{1.0};
-        
-        for (size_t i = 0; i < this->bodies().size(); ++i) {
-            const auto& body_i = this->bodies()[i];
-            T kinetic_energy = T{0.5} * body_i.mass() * body_i.velocity().magnitude_squared();
-            total_energy += kinetic_energy;
-            
-            for (size_t j = i + 1; j < this->bodies().size(); ++j) {
-                const auto& body_j = this->bodies()[j];
-                T distance = (body_i.position() - body_j.position()).magnitude();
-                if (distance > T{0}) {
-                    T potential_energy = -G * body_i.mass() * body_j.mass() / distance;
-                    total_energy += potential_energy;
-                }
-            }
-        }
-        
-        return total_energy;
+        return this->kinetic_energy() - G * this->potential_sum();
     }
     
 private:
@@ -3,6 +3,7 @@
 #include <cmath>
 
 #include "core/DoubleDouble.h"
+#include "core/KeplerPropagator.hpp"
 #include "systems/System.hpp"
 
 
@@ -12,6 +13,11 @@ namespace nbody {
 template <typename T>
 class TwoBodySystem : public System<T> {
 public:
+    // Число тел известно на этапе компиляции (см. FixedNewtonianSimulator)
+    static constexpr std::size_t fixed_size = 2;
+    // Движение плоское (z = 0)
+    static constexpr std::size_t dimensions = 2;
+
     TwoBodySystem(T e = T{0.5}) : e_(e) {
         if (e_ < 0.0 || e_ >= 1.0) {
             throw std::invalid_argument("Эксцентриситет должен быть в диапазоне [0, 1)");
@@ -39,8 +45,8 @@ public:
         Vector<T> vel1(T{0}, T{0}, T{0});
         Vector<T> vel2(T{0}, v_orbit, T{0});
 
-        this->add_body(Body<T>(mass1, pos1, vel1, "Центральное тело"));
-        this->add_body(Body<T>(mass2, pos2, vel2, "Спутник"));
+        this->add_body(Body<T>(mass1, pos1, vel1), "Центральное тело");
+        this->add_body(Body<T>(mass2, pos2, vel2), "Спутник");
 
         a_ = a;
         G_ = G;
@@ -48,6 +54,7 @@ public:
         
         period_ = T{2.0} * M_PI * sqrt(a * a * a / (G * mass1));
         initial_position_ = pos2;
+        initial_velocity_ = vel2;
     }
     
     bool is_valid() const override {
@@ -62,64 +69,35 @@ public:
                       << pos_diff.magnitude() << std::endl;
             next_check_time_ += period_ * T{0.1};
         }
-
-        if (time_ > period_) {
-            time_ = T{0};
-            next_check_time_ = period_ * T{0.1};
-            std::cout << "TwoBodySystem -- INFO: проверка точного решения: период пройден успешно" << std::endl;
-        }
         
         return true;
     }
     
-    void update_time(T dt) {
-        time_ += dt;
-    }
-    
     T graph_value() const override {
-        T total_energy = T{0};
         const T G = T{1.0};
-        
-        for (size_t i = 0; i < this->bodies().size(); ++i) {
-            const auto& body_i = this->bodies()[i];
-            T kinetic_energy = T{0.5} * body_i.mass() * body_i.velocity().magnitude_squared();
-            total_energy += kinetic_energy;
-            
-            for (size_t j = i + 1; j < this->bodies().size(); ++j) {
-                const auto& body_j = this->bodies()[j];
-                T distance = (body_i.position() - body_j.position()).magnitude();
-                if (distance > T{0}) {
-                    T potential_energy = -G * body_i.mass() * body_j.mass() / distance;
-                    total_energy += potential_energy;
-                }
-            }
-        }
-        
-        return total_energy;
+        return this->kinetic_energy() - G * this->potential_sum();
     }
     
-private:
-    Vector<T> calculate_exact_position(T t) const {
-        const T n = sqrt(G_ * m1_ / (a_ * a_ * a_));
-        const T M = n * t;
-
-        T E = M;
-        const int max_iterations = 20;
-        const T epsilon = T{1e-12};
-        
-        for (int i = 0; i < max_iterations; ++i) {
-            const T E_next = M + e_ * sin(E);
-            if (abs(E_next - E) < epsilon) {
-                E = E_next;
-                break;
+protected:
+    // Время берётся по модулю периода на каждом шаге, а не при проверке: точное решение
+    // сравнивается с той же фазой орбиты при любой частоте вызовов is_valid
+    void on_step(T dt) override {
+        time_ += dt;
+        if (time_ >= period_ && period_ > T{0}) {
+            while (time_ >= period_) {
+                time_ -= period_;
             }
-            E = E_next;
+            next_check_time_ = period_ * T{0.1};
+            std::cout << "TwoBodySystem -- INFO: проверка точного решения: период пройден успешно" << std::endl;
         }
+    }
 
-        const T x = a_ * (cos(E) - e_);
-        const T y = a_ * sqrt(T{1.0} - e_ * e_) * sin(E);
-        
-        return Vector<T>(x, y, T{0});
+private:
+    Vector<T> calculate_exact_position(T t) const {
+        Vector<T> position = initial_position_;
+        Vector<T> velocity = initial_velocity_;
+        KeplerPropagator<T>::propagate(position, velocity, G_ * m1_, t);
+        return position;
     }
     
 private:
@@ -127,10 +105,11 @@ private:
     T a_;                              // Большая полуось
     T G_;                              // Гравитационная постоянная
     T m1_;                             // Масса центрального тела
-    mutable T time_ = T{0};            // Текущее время симуляции
+    T time_ = T{0};                    // Время от начала текущего периода
     mutable T next_check_time_ = T{0}; // Время следующей проверки
     T period_ = T{0};                  // Период обращения
     Vector<T> initial_position_;       // Начальная позиция спутника
+    Vector<T> initial_velocity_;       // Начальная скорость спутника
 };
 
 } // namespace nbody 
\ No newline at end of file